@@ -426,7 +426,9 @@ typedef struct tyhashnode {
 	
 	byte fldisposewhenunlocked: 1; /*node must be disposed when lock count reaches zero*/
 	
-	byte flunused: 3; /*round to byte boundry*/
+	byte flhandlerstats: 1; /*is there a handler stats record for this node? see langfunctioncall*/
+	
+	byte flunused: 2; /*round to byte boundry*/
 	
 	byte ctlocks: 8;
 	
@@ -506,6 +508,8 @@ typedef struct tyhashtable {
 	
 	langvaluecallback valueroutine; /*for EFP's -- C routine that evaluates verbs*/
 	
+	short cttmpinuse; /*slots at the bottom of tmpstack that may hold temps; the rest are empty*/
+	
 	short cttmpstack;
 	
 	tyvaluerecord tmpstack []; /*temps generated during expression evaluation*/
@@ -770,6 +774,14 @@ extern boolean langrun (Handle, tyvaluerecord *);
 
 extern boolean langruntraperror (Handle, tyvaluerecord *, bigstring);
 
+extern void langrenumbertree (hdltreenode);
+
+extern boolean langrunprebuilt (hdltreenode, tyvaluerecord *);
+
+extern boolean langrunprebuilttraperror (hdltreenode, tyvaluerecord *, bigstring);
+
+extern boolean langbuildtreetraperror (Handle, hdltreenode *, bigstring);
+
 extern boolean langrunhandle (Handle, bigstring);
 
 extern boolean langrunhandletraperror (Handle, bigstring, bigstring);
@@ -1312,6 +1324,10 @@ extern boolean langhandlercall (hdltreenode, hdltreenode, tyvaluerecord *);
 
 extern boolean langfunctioncall (hdltreenode, hdlhashtable, hdlhashnode, bigstring, hdltreenode, hdltreenode, tyvaluerecord *);
 
+extern void langhandlerstatsdisposed (hdlhashnode);
+
+extern boolean langgethandlerstats (hdlhashtable, boolean);
+
 extern boolean functionvalue (hdltreenode, hdltreenode, tyvaluerecord *);
 
 
@@ -518,6 +518,8 @@ extern boolean pushlastlink (hdltreenode, hdltreenode);
 
 extern boolean pushlastoptionallink (hdltreenode, hdltreenode, hdltreenode *);
 
+#define langcodeversion 1 /*bump whenever the parser or code tree layout changes; invalidates cached code*/
+
 extern boolean langpacktree (hdltreenode, Handle *);
 
 extern boolean langunpacktree (Handle, hdltreenode *);
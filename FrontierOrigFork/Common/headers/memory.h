@@ -52,6 +52,44 @@ typedef struct handlestream {
 #define isemptyhandle(h) (gethandlesize(h)==0)
 
 
+typedef struct tyhandlecacheitem {
+	
+	/*
+	header of an item in a handlecache; a cache's own item records 
+	start with one of these, and add whatever they're caching
+	*/
+	
+	struct tyhandlecacheitem **hnext; /*next less recently used item*/
+	
+	struct tyhandlecacheitem **hprev; /*next more recently used item*/
+	
+	struct tyhandlecacheitem **hnextinbucket; /*next item whose hashval falls in the same bucket*/
+	
+	unsigned long hashval; /*hashhandle of hkey*/
+	
+	Handle hkey; /*the item is found by an exact match of these bytes*/
+	} tyhandlecacheitem, *ptrhandlecacheitem, **hdlhandlecacheitem;
+
+
+#define cthandlecachebuckets 128
+
+typedef struct tyhandlecache { /*an lru cache keyed by handle contents; initialize with {ctmax}*/
+	
+	long ctmax; /*handlecachetrim evicts down to this many items*/
+	
+	long ctitems;
+	
+	hdlhandlecacheitem hfirst; /*most recently used*/
+	
+	hdlhandlecacheitem hlast; /*least recently used, the next to go*/
+	
+	hdlhandlecacheitem buckets [cthandlecachebuckets]; /*items by hashval, so a lookup only compares keys that hash alike*/
+	} tyhandlecache;
+
+
+extern unsigned long ctbytesallocated; /*memory.c*/
+
+
 extern boolean newhandle (long, Handle *);
 
 extern boolean newemptyhandle (Handle *);
@@ -114,6 +152,16 @@ extern long searchhandle (Handle, Handle, long, long);
 
 extern long searchhandleunicase (Handle, Handle, long, long);
 
+extern unsigned long hashbytes (ptrvoid, long);
+
+extern unsigned long hashhandle (Handle);
+
+extern boolean handlecachelookup (tyhandlecache *, Handle, unsigned long, hdlhandlecacheitem *);
+
+extern void handlecacheinsert (tyhandlecache *, hdlhandlecacheitem);
+
+extern boolean handlecachetrim (tyhandlecache *, hdlhandlecacheitem *);
+
 extern boolean sethandlecontents (ptrvoid, long, Handle);
 
 extern void texttostring (ptrvoid, long, bigstring);
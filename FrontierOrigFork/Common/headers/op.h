@@ -434,6 +434,8 @@ typedef struct tyoutlinerecord {
 	
 	unsigned long outlinesignature; /*to identify client*/
 	
+	dbaddress adrcodecache; /*for scripts, db block holding the last compiled code; saved in the packed header*/
+	
 	long outlinetype; /*for use by application. types in opinternal.h*/
 	
 	long outlinerefcon; /*for use by application*/
@@ -535,6 +537,8 @@ extern void opoutermostsummit (hdlheadrecord *);
 
 extern boolean opgetlangtext (hdloutlinerecord, boolean, Handle *); /*oplangtext.c*/
 
+extern boolean opgetlangtextbreaks (hdloutlinerecord, Handle *, Handle *);
+
 
 extern boolean oppushoutline (hdloutlinerecord); /*opops.c*/
 
@@ -575,6 +579,10 @@ extern boolean opunpack (Handle, long *, hdloutlinerecord *);
 
 extern boolean opunpackoutline (Handle, hdloutlinerecord *);
 
+extern boolean opgetpackedcodecache (Handle, dbaddress *);
+
+extern boolean opsetpackedcodecache (Handle, dbaddress);
+
 extern boolean optextscraptooutline (hdloutlinerecord, Handle, hdlheadrecord *);
 
 extern boolean opoutlinetotextstream (hdloutlinerecord, boolean, struct handlestream *);
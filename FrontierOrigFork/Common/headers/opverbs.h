@@ -78,6 +78,14 @@ extern boolean opverbcopyvalue (hdlexternalvariable, hdlexternalvariable *);
 
 extern boolean opverbgetlangtext (hdlexternalvariable, boolean, Handle *, long *);
 
+extern boolean opverbgetscripttext (hdlexternalvariable, Handle *, Handle *, long *, dbaddress *);
+
+extern boolean opverbrefcodecache (hdlexternalvariable, dbaddress, Handle *);
+
+extern void opverbsetcodecachepending (hdlexternalvariable);
+
+extern boolean opverbcodecachepending (hdlexternalvariable);
+
 extern boolean getoutlinevalue (hdltreenode, short, hdloutlinerecord *);
 
 extern boolean opverbarrayreference (hdlexternalvariable, long, hdlheadrecord *);
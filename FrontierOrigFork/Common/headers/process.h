@@ -53,6 +53,8 @@ typedef struct typrocessrecord {
 	
 	hdltreenode holdcode; /*non-nil if code was replaced while agent was running*/
 	
+	long **hcoderefs; /*if hcode is shared, its reference count; the last one released disposes it*/
+	
 	hdlhashtable hcontext; /*non-nil if running from component API or other special cases*/
 	
 	langerrormessagecallback errormessagecallback;
@@ -77,6 +79,10 @@ typedef struct typrocessrecord {
 	
 	boolean floneshot; /*if true process runs once and is then disposed*/
 	
+	boolean flsharedcode; /*hcode belongs to the caller; don't dispose it with a one-shot*/
+	
+	boolean fldisposecontext; /*hcontext was made for this process; dispose it with the process*/
+	
 	boolean flrunning; /*is this processing running now?*/
 	
 	boolean fldisposewhenidle; /*was there an attempt to dispose of this process?*/
@@ -110,6 +116,8 @@ typedef struct typrocesslist {
 	short ctsleeping; /*number of processes in this list currently sleeping*/
 	
 	boolean fldisposewhenidle; /*dispose when ctrunning returns to zero?*/
+	
+	unsigned long nextagenttime; /*no agent is due before this time; 0 if unknown*/
 	} typrocesslist, *ptrprocesslist, **hdlprocesslist;
 
 
@@ -158,6 +166,8 @@ extern boolean processagentsleep (long);
 
 extern boolean processfindcode (hdltreenode, hdlprocessrecord *);
 
+extern void processreleasecode (hdltreenode, long **);
+
 extern void processcodedisposed (long);
 
 extern boolean processreplacecode (hdltreenode, hdltreenode);
@@ -172,6 +182,12 @@ extern boolean processstopprofiling (void);
 
 extern boolean profilingcurrentprocess (void);
 
+extern boolean processstartsampling (unsigned long);
+
+extern boolean processstopsampling (void);
+
+extern boolean processgetsamples (boolean, Handle *);
+
 extern boolean processruncode (hdlprocessrecord, tyvaluerecord *);
 
 extern boolean processruntext (Handle htext);
@@ -245,6 +261,12 @@ extern boolean setdefaulttimeslice (unsigned long);
 
 extern boolean getdefaulttimeslice (unsigned long *);
 
+extern boolean getmaxoneshotthreads (long *);
+
+extern boolean setmaxoneshotthreads (long);
+
+extern long countqueuedoneshots (void);
+
 extern boolean processtimesliceelapsed (void);
 
 extern unsigned long processstackspace (void);
@@ -133,6 +133,8 @@ typedef struct tythreadglobals {
 	
 	unsigned long timetowake;
 	
+	long ixtimeoutheap; /*1-based slot in process.c's timeout heap, 0 if not in it*/
+	
 	unsigned long timeswappedin;
 
 	unsigned long timesliceticks;
@@ -41,6 +41,8 @@
 
 extern boolean scriptbuildtree (Handle, long, hdltreenode *);
 
+extern boolean scriptpackcodecache (Handle, long, hdltreenode, Handle *);
+
 extern boolean scriptrunstartupscripts (void);
 
 extern boolean scriptrunsuspendscripts (void);
@@ -125,7 +125,10 @@ resource 'EFP#' (idopverbs, "op, opattributes, script, osa") {
 		"setbreakpoint",
 		"clearbreakpoint",
 		"startprofile",
-		"stopprofile"
+		"stopprofile",
+		"startsampling",
+		"stopsampling",
+		"getsamples"
 		},
 	
 	"osa", false, {
@@ -883,7 +886,9 @@ resource 'EFP#' (idfrontierverbs, "frontier") {
 		"gethashloopcount",
 		"hideapplication",
 		"isvalidserialnumber",
-		"showapplication"
+		"showapplication",
+		"handlerstats",
+		"benchmark"
 		}
 	}
 };
@@ -914,7 +919,10 @@ resource 'EFP#' (idthreadverbs, "thread") {
 		"begincritical",
 		"endcritical",
 		*/
-		"getstats"
+		"getstats",
+		"getmaxoneshots",
+		"setmaxoneshots",
+		"getqueuedepth"
 		}
 	}
 };
@@ -1018,7 +1026,8 @@ resource 'EFP#' (idhtmlverbs, "html") {
 		"getpagetableaddress",
 		"neutermacros",
 		"neutertags",
-		"drawcalendar"
+		"drawcalendar",
+		"getmacrocacheinfo"
 		},
 	
 	"searchengine", false, {
@@ -1054,6 +1063,9 @@ resource 'EFP#' (idhtmlverbs, "html") {
 		"buildresponse",
 		"builderrorpage",
 		"getserverstring",
+		"streamheaders",
+		"streamchunk",
+		"streamend",
 		},
 	
 	"inetd", false, {
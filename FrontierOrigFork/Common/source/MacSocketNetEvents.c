@@ -48,10 +48,13 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
+#include <limits.h>
 #include <unistd.h>
 #include <utime.h>
 #include <sys/errno.h>
+#include <sys/event.h>
 #include <pthread.h>
 #include "frontier.h"
 #include "standard.h"
@@ -109,10 +112,13 @@ typedef struct tysockRecord {
 	long maxdepth;
 	long listenReference;
 	long currentListenDepth;
-	Handle hcallbacktree;
+	hdltreenode hcallbacktree; /*callback (_acceptStream, _acceptRefcon), shared by all of the listener's connections*/
+	long **hcallbackrefs; /*references to hcallbacktree: the listener's plus one per connection process*/
 	ThreadID idthread;
 	hdldatabaserecord hdatabase;
 	boolean flNotification;
+	hdlprocessthread hwaitingprocess; /*script thread asleep until this stream is readable*/
+	unsigned long waitdeadline; /*non-zero while the accepting thread is asleep*/
 } sockRecord;
 
 static sockRecord sockstack[FRONTIER_MAX_STREAM];
@@ -123,11 +129,18 @@ static short sockListenList[FRONTIER_MAX_STREAM];
 typedef struct sockaddr_in SOCKADDR_IN;
 static unsigned long maxlistendepth = 0;
 
+static int kqreactor = -1;
+static short ctacceptwaiters = 0;
+static short ctreadwaiters = 0;
+
 boolean fwsNetEventWriteBufferToStream(unsigned long stream, char *buffer, unsigned long numberOfBytes, unsigned long chunkSize, unsigned long timeoutSecs);
 static void yield(void);
 
 pthread_mutex_t dataLock;
 
+#define STR_P_ACCEPTSTREAM	BIGSTRING ("\x0d" "_acceptStream")
+#define STR_P_ACCEPTREFCON	BIGSTRING ("\x0d" "_acceptRefcon")
+
 #define STR_P_ERROR_CLOSED_PREMATURELY	BIGSTRING ("\x45" "Can't read stream because the TCP connection was closed unexpectedly.")
 
 #pragma mark -
@@ -361,6 +374,8 @@ static void clearsockstack(void) {
 	for (i = 0; i < FRONTIER_MAX_STREAM; i++) {
 		sockstack[i].sockID = INVALID_SOCKET;
 		sockstack[i].typeID = SOCKTYPE_INVALID;
+		sockstack[i].hwaitingprocess = nil;
+		sockstack[i].waitdeadline = 0;
 	}
 	
 	sockListenCount = 0;
@@ -383,6 +398,8 @@ static boolean netEventLaunch(void) {
 			return false;
 		}
 		
+		kqreactor = kqueue(); /*if this fails, readers fall back on polling*/
+		
 		gThreadEntryCallback = NewThreadEntryUPP(acceptingthreadmain);
 		if(gThreadEntryCallback == nil) {
 			memoryerror();
@@ -447,6 +464,145 @@ static void markStreamAsClosed(unsigned long stream) {
 }
 
 
+#pragma mark Reactor
+
+/*
+ Threads waiting for a socket to become readable sleep instead of spinning on
+ select. The socket is added to a kqueue as a one-shot read filter, and
+ fwsNetEventCheckAndAcceptSocket, which the main event loop calls on every pass,
+ drains the queue and wakes whichever thread is waiting on each ready stream.
+ 
+ Script threads sleep with processsleep, so processchecktimeouts handles their
+ timeouts. The accepting threads aren't script threads, so the reactor wakes
+ them itself once their deadline passes.
+ 
+ Either way the queue is only drained when the event loop comes around, so it
+ mustn't sleep long while anyone is waiting on it; see fwsNetEventThreadsWaiting.
+ */
+
+static boolean waitForStreamReadable(unsigned long stream, unsigned long timeoutTicks, boolean flAcceptingThread) {
+	
+	/* Returns false without sleeping if the caller has to keep polling. */
+	
+	SOCKET sock = socketForStream(stream);
+	
+	if (kqreactor == -1 || sock == INVALID_SOCKET)
+		return false;
+	
+	if (!flAcceptingThread && (inmainthread() || getcurrentthreadglobals() == nil))
+		return false;
+	
+	struct kevent change;
+	EV_SET(&change, sock, EVFILT_READ, EV_ADD | EV_ONESHOT, 0, 0, (void *)stream);
+	
+	if (kevent(kqreactor, &change, 1, NULL, 0, NULL) == SOCKET_ERROR)
+		return false;
+	
+	lockData();
+	if (flAcceptingThread) {
+		sockstack[stream].waitdeadline = gettickcount() + timeoutTicks;
+		if (sockstack[stream].waitdeadline == 0)
+			sockstack[stream].waitdeadline = 1;
+		++ctacceptwaiters;
+	}
+	else {
+		sockstack[stream].hwaitingprocess = (hdlprocessthread) getcurrentthreadglobals();
+		++ctreadwaiters;
+	}
+	unlockData();
+	
+	if (flAcceptingThread)
+		threadsleep(nil);
+	else
+		processsleep(nil, timeoutTicks);
+	
+	/* Timed out, or woken by someone else: withdraw. A stale event is ignored by the reactor. */
+	
+	lockData();
+	if (flAcceptingThread) {
+		if (sockstack[stream].waitdeadline != 0) {
+			sockstack[stream].waitdeadline = 0;
+			--ctacceptwaiters;
+		}
+	}
+	else {
+		if (sockstack[stream].hwaitingprocess != nil) {
+			sockstack[stream].hwaitingprocess = nil;
+			--ctreadwaiters;
+		}
+	}
+	unlockData();
+	
+	return true;
+}
+
+
+static void wakeStreamWaiter(unsigned long stream) {
+	
+	lockData();
+	hdlprocessthread hprocess = sockstack[stream].hwaitingprocess;
+	if (hprocess != nil) {
+		sockstack[stream].hwaitingprocess = nil;
+		--ctreadwaiters;
+	}
+	
+	boolean flAccepting = sockstack[stream].waitdeadline != 0;
+	if (flAccepting) {
+		sockstack[stream].waitdeadline = 0;
+		--ctacceptwaiters;
+	}
+	unlockData();
+	
+	if (hprocess != nil)
+		processwake(hprocess);
+	
+	if (flAccepting)
+		threadwake((hdlthread) sockstack[stream].idthread, false);
+}
+
+
+static void pollReactor(void) {
+	
+	if (kqreactor == -1)
+		return;
+	
+	struct kevent events[32];
+	struct timespec timeout = {0, 0};
+	int ctevents = kevent(kqreactor, NULL, 0, events, 32, &timeout);
+	int i;
+	
+	for (i = 0; i < ctevents; i++) {
+		unsigned long stream = (unsigned long)events[i].udata;
+		
+		if (stream > 0 && stream < FRONTIER_MAX_STREAM)
+			wakeStreamWaiter(stream);
+	}
+	
+	if (ctacceptwaiters > 0) {
+		unsigned long ticks = gettickcount();
+		
+		for (i = 1; i < FRONTIER_MAX_STREAM; i++) {
+			unsigned long deadline = sockstack[i].waitdeadline;
+			
+			if (deadline != 0 && (long)(ticks - deadline) >= 0)
+				wakeStreamWaiter(i);
+		}
+	}
+}
+
+
+boolean fwsNetEventThreadsWaiting(void) {
+	
+	/*
+	 The event loop shouldn't sleep long while anyone is waiting on the reactor.
+	 Sleeping readers count as sleeping processes, so processrunning doesn't
+	 keep the loop awake for them.
+	 */
+	
+	return (ctacceptwaiters > 0) || (ctreadwaiters > 0);
+}
+
+
 #pragma mark Errors
 
 
@@ -906,7 +1062,14 @@ static void initsockrecord(long i) {
 	copystring(emptystring, sockstack[i].callback);
 	sockstack[i].flNotification = false;
 	sockstack[i].hcallbacktree = nil;
+	sockstack[i].hcallbackrefs = nil;
 	sockstack[i].hdatabase = nil;
+	if (sockstack[i].hwaitingprocess != nil) /*keep the reactor's counts honest*/
+		--ctreadwaiters;
+	sockstack[i].hwaitingprocess = nil;
+	if (sockstack[i].waitdeadline != 0)
+		--ctacceptwaiters;
+	sockstack[i].waitdeadline = 0;
 	unlockData();
 	//	TCPOUT();
 }
@@ -1129,12 +1292,20 @@ static void yield(void) {
 }
 
 
-static boolean getcallbackcodetree(bigstring bs, Handle *htree) {
+static boolean getcallbackcodetree(bigstring bs, hdltreenode *htree) {
+	
+	/*
+	 Build the code every connection to this listener runs, once:
+	 callback (_acceptStream, _acceptRefcon). runcallback binds the two
+	 names in a context table for each connection's process.
+	 */
 	
 	TCPIN();
 	Handle htext = nil;
-	if (!newtexthandle(bs, &htext))
+	if (!newtexthandle(bs, &htext)) {
+		TCPOUT();
 		return false;
+	}
 	
 	unsigned long savelines = ctscanlines;	
 	unsigned short savechars = ctscanchars;
@@ -1145,14 +1316,54 @@ static boolean getcallbackcodetree(bigstring bs, Handle *htree) {
 	ctscanlines = savelines;
 	ctscanchars = savechars;
 	
-	if (!fl)
-		return false; 
+	if (!fl) {
+		TCPOUT();
+		return false;
+	}
 	
-	fl = langpacktree((**hmodule).param1, htree); /*make a copy of the sub-tree*/
+	Handle hpacked = nil;
+	hdltreenode hcallbackaddress = nil;
+	fl = langpacktree((**hmodule).param1, &hpacked) && langunpacktree(hpacked, &hcallbackaddress); /*make a copy of the sub-tree*/
 	langdisposetree(hmodule);
-	TCPOUT();
 	
-	return fl;
+	if (!fl) {
+		TCPOUT();
+		return false;
+	}
+	
+	tyvaluerecord val;
+	hdltreenode hparam1 = nil, hparam2 = nil;
+	
+	if (!setstringvalue(STR_P_ACCEPTSTREAM, &val) || !newidnode(val, &hparam1)) {
+		langdisposetree(hcallbackaddress);
+		TCPOUT();
+		return false;
+	}
+	exemptfromtmpstack(&val);
+	
+	if (!setstringvalue(STR_P_ACCEPTREFCON, &val) || !newidnode(val, &hparam2)) {
+		langdisposetree(hcallbackaddress);
+		langdisposetree(hparam1);
+		TCPOUT();
+		return false;
+	}
+	exemptfromtmpstack(&val);
+	
+	pushlastlink(hparam2, hparam1);
+	
+	hdltreenode hfunctioncall = nil;
+	if (!pushbinaryoperation(functionop, hcallbackaddress, hparam1, &hfunctioncall)) {
+		TCPOUT();
+		return false;
+	}
+	
+	if (!pushbinaryoperation(moduleop, hfunctioncall, nil, htree)) {
+		TCPOUT();
+		return false;
+	}
+	
+	TCPOUT();
+	return true;
 }
 
 
@@ -1204,48 +1415,44 @@ static boolean _newProcess(hdltreenode hcode, bigstring bsname, hdlprocessrecord
 
 static boolean runcallback (long listenstream, long acceptstream, long refcon) {
 	
-	TCPIN();
-	Handle h = nil;
-	if (!copyhandle(sockstack[listenstream].hcallbacktree, &h))
-		return false;
-	
-	hdltreenode hcallbackaddress = nil;
-	if (!langunpacktree(h, &hcallbackaddress))
-		return false;
-	
-	tyvaluerecord val;
-	setlongvalue(acceptstream, &val);
+	/*
+	 Run the listener's prebuilt code in a new process. Only the stream and refcon
+	 differ per connection; they go in the process's context table, which the
+	 process disposes along with itself. The process holds a reference to the
+	 code, so a connection that outlives its listener still disposes of it.
+	 
+	 The context isn't a fresh allocation once a listener is warm: newhashtable
+	 takes the table from langhash.c's free list, the two nodes come off its
+	 free list for nodes of local tables, and disposeprocess hands both back.
+	 */
 	
-	hdltreenode hparam1 = nil;
-	if (!newconstnode(val, &hparam1)) {
-		langdisposetree(hcallbackaddress);
+	TCPIN();
+	hdlhashtable hcontext = nil;
+	if (!newhashtable(&hcontext)) {
+		TCPOUT();
 		return false;
 	}
 	
-	setlongvalue(refcon, &val);
+	(**hcontext).fllocaltable = true;
 	
-	hdltreenode hparam2 = nil;
-	if (!newconstnode(val, &hparam2)) {
-		langdisposetree(hcallbackaddress);
-		langdisposetree(hparam1);
+	if (!langassignlongvalue(hcontext, STR_P_ACCEPTSTREAM, acceptstream) || !langassignlongvalue(hcontext, STR_P_ACCEPTREFCON, refcon)) {
+		disposehashtable(hcontext, false);
+		TCPOUT();
 		return false;
 	}
 	
-	pushlastlink(hparam2, hparam1);
-	
-	hdltreenode hfunctioncall = nil;
-	if (!pushbinaryoperation(functionop, hcallbackaddress, hparam1, &hfunctioncall))
-		return false;
-	
-	hdltreenode hcode = nil;
-	if (!pushbinaryoperation(moduleop, hfunctioncall, nil, &hcode))
-		return false;
-	
 	hdlprocessrecord hprocess = nil;
-	if (!_newProcess(hcode, sockstack[listenstream].callback, &hprocess)) {
-		langdisposetree(hcode);
+	if (!_newProcess(sockstack[listenstream].hcallbacktree, sockstack[listenstream].callback, &hprocess)) {
+		disposehashtable(hcontext, false);
+		TCPOUT();
 		return false;
 	}
+	
+	(**hprocess).flsharedcode = true;
+	(**hprocess).hcoderefs = sockstack[listenstream].hcallbackrefs;
+	++**(**hprocess).hcoderefs;
+	(**hprocess).hcontext = hcontext;
+	(**hprocess).fldisposecontext = true;
 	TCPOUT();
 	return addprocess(hprocess);
 }
@@ -1413,12 +1620,152 @@ static boolean transmitfile(unsigned long stream, ptrfilespec fs) {
 }
 
 
+static int openfileforsendfile(ptrfilespec fs) {
+	
+	FSRef fsref;
+	char path[PATH_MAX];
+	
+	if (macgetfsref(fs, &fsref) != noErr)
+		return -1;
+	
+	if (FSRefMakePath(&fsref, (UInt8 *)path, sizeof(path)) != noErr)
+		return -1;
+	
+	return open(path, O_RDONLY);
+}
+
+
+static boolean sendfiletostream(unsigned long stream, Handle hprefix, Handle hsuffix, ptrfilespec fs, boolean *flhandled) {
+	
+	/*
+	 Send the prefix, the file and the suffix with sendfile(2). The kernel reads the
+	 file straight into the socket, and the prefix goes out as a header in the same
+	 call, so a typical response is one syscall with no user-space copy of the body.
+	 If sendfile can't be used, sets *flhandled to false without sending anything.
+	 */
+	
+	*flhandled = false;
+	
+	SOCKET sock = socketForStream(stream);
+	if (!socketIsValid(sock))
+		return false;
+	
+	int fd = openfileforsendfile(fs);
+	if (fd == -1)
+		return false;
+	
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return false;
+	}
+	
+	off_t ctprefix = (hprefix == nil) ? 0 : gethandlesize(hprefix);
+	off_t ctfile = st.st_size;
+	off_t ctsuffix = (hsuffix == nil) ? 0 : gethandlesize(hsuffix);
+	off_t ctsent = 0;
+	UInt32 lastSendTickCount = TickCount();
+	int errorCode = 0;
+	
+	if (hprefix != nil)
+		lockhandle(hprefix);
+	if (hsuffix != nil)
+		lockhandle(hsuffix);
+	
+	while (ctsent < ctprefix + ctfile) {
+		
+		if ((TickCount() - lastSendTickCount) > (kDefaultTimeoutSecs * 60)) {
+			errorCode = ETIMEDOUT;
+			break;
+		}
+		
+		struct iovec header, trailer;
+		struct sf_hdtr hdtr = {nil, 0, nil, 0};
+		
+		if (ctsent < ctprefix) {
+			header.iov_base = *hprefix + ctsent;
+			header.iov_len = ctprefix - ctsent;
+			hdtr.headers = &header;
+			hdtr.hdr_cnt = 1;
+		}
+		
+		if (ctsuffix > 0) { /*only goes out once the file has*/
+			trailer.iov_base = *hsuffix;
+			trailer.iov_len = ctsuffix;
+			hdtr.trailers = &trailer;
+			hdtr.trl_cnt = 1;
+		}
+		
+		off_t fileoffset = (ctsent > ctprefix) ? ctsent - ctprefix : 0;
+		off_t len = 0; /*through end of file*/
+		int res = sendfile(fd, sock, fileoffset, &len, &hdtr, 0);
+		errorCode = errno;
+		
+		if (len > 0) {
+			ctsent += len;
+			lastSendTickCount = TickCount();
+			*flhandled = true;
+		}
+		
+		if (res == SOCKET_ERROR) {
+			if (errorCode != EAGAIN && errorCode != EINTR)
+				break;
+			yield();
+			continue;
+		}
+		
+		errorCode = 0;
+		if (len == 0) { /*file shrank while we were sending it*/
+			errorCode = -1;
+			break;
+		}
+	}
+	
+	close(fd);
+	if (hprefix != nil)
+		unlockhandle(hprefix);
+	
+	if (ctsent < ctprefix + ctfile) {
+		if (hsuffix != nil)
+			unlockhandle(hsuffix);
+		if (*flhandled)
+			neterror("write stream", errorCode);
+		return false;
+	}
+	
+	*flhandled = true;
+	
+	/*whatever part of the suffix the last sendfile didn't get out*/
+	
+	boolean fl = true;
+	off_t ixsuffix = ctsent - (ctprefix + ctfile);
+	
+	if (ixsuffix < ctsuffix)
+		fl = fwsNetEventWriteBufferToStream(stream, *hsuffix + ixsuffix, ctsuffix - ixsuffix, 0, 0);
+	
+	if (hsuffix != nil)
+		unlockhandle(hsuffix);
+	
+	return fl;
+}
+
+
 boolean fwsNetEventWriteFileToStream(unsigned long stream, Handle hprefix, Handle hsuffix, ptrfilespec fs) {
 	
 	TCPINSTREAM(stream);
 	if (!netEventLaunch())
 		return false;
 	
+	boolean flhandled;
+	boolean fl = sendfiletostream(stream, hprefix, hsuffix, fs, &flhandled);
+	
+	if (flhandled) {
+		TCPOUTSTREAM(stream);
+		return fl;
+	}
+	
+	/*sendfile isn't available for this file or socket; copy it through a buffer*/
+	
 	if (hprefix != nil && !fwsNetEventWriteHandleToStream(stream, hprefix, 0, 0))
 		return false;
 	
@@ -1528,7 +1875,8 @@ static void *acceptingthreadmain(void *param) {
 	sockRecord *sockrecptr = &sockstack[listenstream];
 	unlockData();
 	SOCKET sock = sockrecptr->sockID;
-	Handle hcallback = sockrecptr->hcallbacktree; /*keep a copy in our stack so we can safely dispose it*/	
+	hdltreenode hcallback = sockrecptr->hcallbacktree; /*keep a copy in our stack so we can safely dispose it*/	
+	long **hcallbackrefs = sockrecptr->hcallbackrefs;
 	long maxdepth = sockrecptr->maxdepth;
 	
 	while (sockrecptr->typeID == SOCKTYPE_LISTENING) {
@@ -1547,10 +1895,12 @@ static void *acceptingthreadmain(void *param) {
 				YieldToAnyThread();
 			}
 		}
+		else
+			waitForStreamReadable(listenstream, 60, true); /*wake once a second to notice a stopped listener*/
 		YieldToAnyThread();
 	}	
 	
-	disposehandle(hcallback);
+	processreleasecode(hcallback, hcallbackrefs); /*a connection still running it disposes it when it's done*/
 	
 	lockData();
 	if (sockrecptr->typeID == SOCKTYPE_LISTENSTOPPED) {
@@ -1589,10 +1939,17 @@ boolean fwsNetEventListenStream(unsigned long port, long depth, bigstring callba
 	TCPprintf(sprintf((char *)TCPmsg, "Entering fwsNetEventListenStream at line %d. Port = %ld, Depth = %ld, Refcon = %ld, Callback = %s.\n", __LINE__, port, depth, refcon, stringbaseaddress(callback)));
 	TCPWRITEMSG ();
 	
-	Handle hcallbacktree = nil;
+	hdltreenode hcallbacktree = nil;
 	if (!getcallbackcodetree(callback, &hcallbacktree))
 		return false;
 	
+	long **hcallbackrefs = nil;
+	if (!newclearhandle(sizeof(long), (Handle *)&hcallbackrefs)) {
+		langdisposetree(hcallbacktree);
+		return false;
+	}
+	**hcallbackrefs = 1; /*the listener's*/
+	
 	SOCKET sock = socket(PF_INET, SOCK_STREAM, 0);
 	
 	int errcode;
@@ -1601,7 +1958,8 @@ boolean fwsNetEventListenStream(unsigned long port, long depth, bigstring callba
 	if (sock == INVALID_SOCKET) {
 		errcode = h_errno;
 		setStreamStatus(streamref, SOCKTYPE_INACTIVE);
-		disposehandle(hcallbacktree);
+		langdisposetree(hcallbacktree);
+		disposehandle((Handle)hcallbackrefs);
 		neterror("create listen stream", errcode);
 		return false;
 	}
@@ -1624,7 +1982,8 @@ boolean fwsNetEventListenStream(unsigned long port, long depth, bigstring callba
 		neterror("bind listen stream", errcode);
 		close(sock);
 		setStreamStatus(streamref, SOCKTYPE_INACTIVE);
-		disposehandle(hcallbacktree);
+		langdisposetree(hcallbacktree);
+		disposehandle((Handle)hcallbackrefs);
 		return false;
 	} 
 	
@@ -1633,7 +1992,8 @@ boolean fwsNetEventListenStream(unsigned long port, long depth, bigstring callba
 		neterror("setup listen stream", errcode);
 		close(sock);
 		setStreamStatus(streamref, SOCKTYPE_INACTIVE);
-		disposehandle(hcallbacktree);
+		langdisposetree(hcallbacktree);
+		disposehandle((Handle)hcallbackrefs);
 		return false;
 	}
 	
@@ -1646,6 +2006,7 @@ boolean fwsNetEventListenStream(unsigned long port, long depth, bigstring callba
 	sockstack[streamref].listenReference = 0;
 	sockstack[streamref].currentListenDepth = 0;
 	sockstack[streamref].hcallbacktree = hcallbacktree;
+	sockstack[streamref].hcallbackrefs = hcallbackrefs;
 	
 	*stream = streamref;
 	
@@ -1655,7 +2016,8 @@ boolean fwsNetEventListenStream(unsigned long port, long depth, bigstring callba
 	if (!launchacceptingthread(streamref)) {
 		close(sock);
 		setStreamStatus(streamref, SOCKTYPE_INACTIVE);
-		disposehandle(hcallbacktree);
+		langdisposetree(hcallbacktree);
+		disposehandle((Handle)hcallbackrefs);
 		return false;
 	}
 	
@@ -1761,6 +2123,8 @@ boolean fwsNetEventCheckAndAcceptSocket(void) {
 	if (!frontierWinSockLoaded)
 		return false;
 	
+	pollReactor();
+	
 	boolean fl = true;
 	int i;
 	for (i = 0; i < sockListenCount; i++) {
@@ -2038,7 +2402,17 @@ static boolean readStreamUntilCondition(unsigned long stream, Handle hbuffer, fw
 				
 			}				
 				break;
-			case 0:
+			case 0: { /*nothing yet -- sleep until the reactor sees data or we time out*/
+				UInt32 elapsedTicks = TickCount() - lastReadTickCount;
+				
+				if (elapsedTicks >= (timeoutSecs * 60)) { /*don't let the wait below wrap*/
+					errorCode = ETIMEDOUT;
+					goto exit_error;
+				}
+				
+				waitForStreamReadable(stream, max(1, (timeoutSecs * 60) - elapsedTicks), false);
+			}
+				break;
 			case SOCKET_ERROR:
 				errorCode = errno;
 				if (errorCode == EWOULDBLOCK)
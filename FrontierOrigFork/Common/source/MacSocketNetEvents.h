@@ -105,6 +105,8 @@ extern boolean fwsNetEventStatusStream (unsigned long stream, bigstring status,
 
 extern boolean fwsNetEventCheckAndAcceptSocket (void);
 
+extern boolean fwsNetEventThreadsWaiting (void);
+
 /* Close a listen and delete associated data */
 extern boolean fwsNetEventCloseListen (unsigned long stream);
 
@@ -722,7 +722,20 @@ static boolean renumberlinesvisit (hdltreenode hnode, ptrvoid refcon) {
 	} /*renumberlinesvisit*/
 
 
-boolean langrun (Handle htext, tyvaluerecord *val) {
+void langrenumbertree (hdltreenode hcode) {
+	
+	/*
+	make every node of hcode point to the current line and character of 
+	the running script, if any. for callers that build a tree once and run 
+	it with langrunprebuilt many times; it's numbered when it's built
+	*/
+	
+	if (flscriptrunning)
+		langvisitcodetree (hcode, &renumberlinesvisit, nil);
+	} /*langrenumbertree*/
+
+
+static boolean langruntree (Handle htext, hdltreenode hprebuilt, tyvaluerecord *val) {
 	
 	/*
 	compile and run the program source in htext.  if the syntax checks, and
@@ -762,6 +775,9 @@ boolean langrun (Handle htext, tyvaluerecord *val) {
 	
 	4.1b11 dmb: use new flevaluateglobalwith flag to avoid passing this as 
 	a parameter everywhere. Running card scripts needs it.
+	
+	if htext is nil, run the already-compiled hprebuilt instead. it belongs 
+	to our caller and is not disposed, or renumbered; see langrenumbertree.
 	*/
 	
 	register boolean fl;
@@ -784,7 +800,14 @@ boolean langrun (Handle htext, tyvaluerecord *val) {
 	
 	flevaluateglobalwith = false; /*reset every time*/
 	
-	fl = langbuildtree (htext, true, &hcode);
+	if (htext == nil) {
+		
+		hcode = hprebuilt;
+		
+		fl = true;
+		}
+	else
+		fl = langbuildtree (htext, true, &hcode);
 	
 	if (!fl)
 		goto exit;
@@ -795,7 +818,8 @@ boolean langrun (Handle htext, tyvaluerecord *val) {
 		
 		ctscanchars = savechars;
 		
-		langvisitcodetree (hcode, &renumberlinesvisit, nil);
+		if (htext != nil) /*a prebuilt tree was numbered once, when it was built*/
+			langvisitcodetree (hcode, &renumberlinesvisit, nil);
 		}
 	
 	else {
@@ -830,7 +854,8 @@ boolean langrun (Handle htext, tyvaluerecord *val) {
 	
 	langpostscript ();
 	
-	langdisposetree (hcode);
+	if (htext != nil)
+		langdisposetree (hcode);
 	
 	exit:
 	
@@ -842,9 +867,31 @@ boolean langrun (Handle htext, tyvaluerecord *val) {
 	flscriptrunning = flscriptalreadyrunning;
 	
 	return (fl);
+	} /*langruntree*/
+
+
+boolean langrun (Handle htext, tyvaluerecord *val) {
+	
+	/*
+	we consume the text handle -- it is disposed before we return.
+	*/
+	
+	return (langruntree (htext, nil, val));
 	} /*langrun*/
 
 
+boolean langrunprebuilt (hdltreenode hcode, tyvaluerecord *val) {
+	
+	/*
+	like langrun, but for a code tree that's already been built. the tree is 
+	not disposed, so callers can cache it and run it again. unlike langrun, 
+	we don't renumber its nodes on every run; callers langrenumbertree once.
+	*/
+	
+	return (langruntree (nil, hcode, val));
+	} /*langrunprebuilt*/
+
+
 boolean langrunhandle (Handle htext, bigstring bsresult) {
 	
 	/*
@@ -945,6 +992,59 @@ boolean langruntraperror (Handle htext, tyvaluerecord *v, bigstring bserror) {
 	} /*langrunhandletraperror*/
 
 
+boolean langrunprebuilttraperror (hdltreenode hcode, tyvaluerecord *v, bigstring bserror) {
+	
+	/*
+	langruntraperror for a prebuilt code tree, which remains our caller's
+	*/
+	
+	boolean fl;
+	langerrormessagecallback savecallback;
+	ptrvoid saverefcon;
+	
+	langtraperrors (bserror, &savecallback, &saverefcon);
+	
+	fl = langrunprebuilt (hcode, v);
+	
+	languntraperrors (savecallback, saverefcon, false);
+	
+	fllangerror = false;
+	
+	return (fl);
+	} /*langrunprebuilttraperror*/
+
+
+boolean langbuildtreetraperror (Handle htext, hdltreenode *hcode, bigstring bserror) {
+	
+	/*
+	compile htext, consuming it, returning a syntax error in bserror. 
+	
+	the scanner position of any running script is preserved, so the 
+	caller can langrenumbertree the result to point at its line.
+	*/
+	
+	boolean fl;
+	langerrormessagecallback savecallback;
+	ptrvoid saverefcon;
+	unsigned short savelines = ctscanlines;
+	unsigned short savechars = ctscanchars;
+	
+	langtraperrors (bserror, &savecallback, &saverefcon);
+	
+	fl = langbuildtree (htext, true, hcode);
+	
+	languntraperrors (savecallback, saverefcon, false);
+	
+	fllangerror = false;
+	
+	ctscanlines = savelines;
+	
+	ctscanchars = savechars;
+	
+	return (fl);
+	} /*langbuildtreetraperror*/
+
+
 boolean langrunhandletraperror (Handle htext, bigstring bsresult, bigstring bserror) {
 	
 	/*
@@ -138,6 +138,14 @@ static hdldatabaserecord hexternalpackdatabase;
 
 static hdlhashtable hfirstfreetable = nil; /*private free list for hash tables*/
 
+#define ctfreelocalnodesmax 128 /*free list for nodes of handler frames*/
+
+#define sizefreelocalnodemax (sizeof (tyhashnode) + 32) /*room for a 31-char name*/
+
+static hdlhashnode freelocalnodes [ctfreelocalnodesmax];
+
+static short ctfreelocalnodes = 0;
+
 
 #ifdef fldebug
 
@@ -408,6 +416,14 @@ boolean newhashtable (hdlhashtable *htable) {
 	
 	5.0d15 dmb: preserve new cttmpstack field. We're assuming that the reused 
 	table pool is mostly for local tables that actually need temp stacks.
+	
+	only clear the header of a reused table. the bucket array is inline in 
+	the header, so it comes back cleared along with the table. the tmpstack 
+	tail is left alone: every table on the free list got there through 
+	disposehashtable, which empties the tmpstack before pushing it, so the 
+	slots are all novaluetype already. anything else that adds to 
+	hfirstfreetable must do the same. a frame that once grew a long 
+	tmpstack shouldn't cost more to set up on every call.
 	*/
 	
 	if (hmagictable != nil) {
@@ -432,9 +448,11 @@ boolean newhashtable (hdlhashtable *htable) {
 		
 		hfirstfreetable = (**hfirstfreetable).prevhashtable;
 		
+		assert ((**ht).cttmpinuse == 0); /*tmpstack emptied by disposehashtable*/
+		
 		ct = (**ht).cttmpstack;
 		
-		clearhandle ((Handle) ht);
+		clearbytes (*ht, sizeof (tyhashtable));
 		
 		(**ht).cttmpstack = ct;
 		
@@ -806,10 +824,37 @@ boolean hashflushcache (long *ctbytesneeded) {
 		disposehandle ((Handle) hfreetable);
 		}
 	
+	while (ctfreelocalnodes > 0)
+		disposehandle ((Handle) freelocalnodes [--ctfreelocalnodes]);
+	
 	return (true);
 	} /*hashflushcache*/
 
 
+static void freehashnode (hdlhashtable ht, hdlhashnode hnode) {
+	
+	/*
+	handler calls create and dispose a local table full of parameters every 
+	time through. keep the nodes of local tables around for newhashnode 
+	to reuse, rather than going through the memory manager for each one.
+	*/
+	
+	if (ht != nil && (**ht).fllocaltable && ctfreelocalnodes < ctfreelocalnodesmax) {
+		
+		if (gethandlesize ((Handle) hnode) <= (long) sizefreelocalnodemax) {
+			
+			unlockhandle ((Handle) hnode); /*must be free to resize when reused*/
+			
+			freelocalnodes [ctfreelocalnodes++] = hnode;
+			
+			return;
+			}
+		}
+	
+	disposehandle ((Handle) hnode);
+	} /*freehashnode*/
+
+
 boolean disposehashnode (hdlhashtable ht, hdlhashnode hnode, boolean fldisposevalue, boolean fldisk) {
 	
 	/*
@@ -835,6 +880,9 @@ boolean disposehashnode (hdlhashtable ht, hdlhashnode hnode, boolean fldisposeva
 	hashunregisteraddressnode (hnode);
 #endif	
 
+	if ((**hn).flhandlerstats)
+		langhandlerstatsdisposed (hn);
+
 	if (fldisposevalue) {
 		
 		boolean flneeddatabase = (fldisk && (**hn).val.fldiskval);
@@ -854,7 +902,7 @@ boolean disposehashnode (hdlhashtable ht, hdlhashnode hnode, boolean fldisposeva
 			dbpopdatabase ();
 		}
 
-	disposehandle ((Handle) hn);
+	freehashnode (ht, hn);
 	
 	return (true);
 	} /*disposehashnode*/
@@ -999,6 +1047,8 @@ boolean disposehashtable (hdlhashtable htable, boolean fldisk) {
 	hashinvalidaterefnodes (ht);
 #endif
 	
+	assert ((**ht).cttmpinuse == 0); /*newhashtable won't clear the tmpstack of a reused table*/
+	
 	(**ht).prevhashtable = hfirstfreetable;
 	
 	hfirstfreetable = ht;
@@ -1234,7 +1284,31 @@ boolean hashsetnodekey (hdlhashtable htable, hdlhashnode hnode, const bigstring
 
 static boolean newhashnode (hdlhashnode *hnode, const bigstring bskey) {
 	
-	if (!newclearhandle (sizeof (tyhashnode) + stringsize (bskey), (Handle *) hnode))
+	/*
+	reuse a node from a disposed local table if we have one; see freehashnode
+	*/
+	
+	long ctbytes = sizeof (tyhashnode) + stringsize (bskey);
+	
+	if (ctfreelocalnodes > 0 && ctbytes <= (long) sizefreelocalnodemax) {
+		
+		hdlhashnode h = freelocalnodes [--ctfreelocalnodes];
+		
+		if (sethandlesize ((Handle) h, ctbytes)) {
+			
+			clearbytes (*h, ctbytes);
+			
+			copystring (bskey, (**h).hashkey);
+			
+			*hnode = h;
+			
+			return (true);
+			}
+		
+		disposehandle ((Handle) h);
+		}
+	
+	if (!newclearhandle (ctbytes, (Handle *) hnode))
 		return (false);
 	
 	copystring (bskey, (***hnode).hashkey);
@@ -67,6 +67,13 @@
 #include "tableverbs.h"  //6.1b8 AR: we need gettablevalue
 #include "byteorder.h"	/* 2006-04-08 aradke: endianness conversion macros */
 
+#ifdef MACVERSION
+	#include <zlib.h>	/* libz.a is linked into the Mac builds */
+	#define flcompressresponses 1
+#else
+	#define flcompressresponses 0
+#endif
+
 #include "iso8859.c"
 
 extern boolean frontierversion (tyvaluerecord *v); //implemted in shellsysverbs.c
@@ -127,6 +134,8 @@ extern boolean sysos (tyvaluerecord *v); //implemted in shellsysverbs.c
 #define STR_P_MISSING_HOST_HEADER		BIGSTRING ("\x40" "Every HTTP/1.1 request must include a Host header")
 #define STR_P_UNSUPPORTED_VERSION		BIGSTRING ("\x24" "This server does not support HTTP/^0")
 #define STR_P_INVALID_URI				BIGSTRING ("\x23" "All URIs must begin with / or http:")
+#define STR_P_HEADERS_ALREADY_SENT		BIGSTRING ("\x2C" "The response headers have already been sent.")
+#define STR_P_STREAM_ALREADY_ENDED		BIGSTRING ("\x28" "The streamed response has already ended.")
 #define STR_P_BODY_NOT_READ				BIGSTRING ("\x22" "The request body couldn't be read.")
 #define STR_P_METHOD_NOT_ALLOWED		BIGSTRING ("\x20" "^0 isn't allowed on this object.")
 #define STR_P_INVALID_REQUEST_LINE		BIGSTRING ("\x1C" "The request line is invalid.")
@@ -173,6 +182,7 @@ extern boolean sysos (tyvaluerecord *v); //implemted in shellsysverbs.c
 #define STR_P_LOGADD					BIGSTRING ("\x16" "log.addToGuestDatabase")
 #define STR_P_USERWEBSERVERCONFIG		BIGSTRING ("\x15" "user.webserver.config")
 #define STR_P_USERWEBSERVERPREFS		BIGSTRING ("\x14" "user.webserver.prefs")
+#define STR_P_MAXKEEPALIVEREQUESTS		BIGSTRING ("\x14" "maxKeepAliveRequests")
 #define STR_P_USERWEBSERVERSTATS		BIGSTRING ("\x14" "user.webserver.stats")
 #define STR_P_INETDCONFIGTABLEADR		BIGSTRING ("\x13" "inetdConfigTableAdr")
 #define STR_P_DEFAULTTIMEOUTSECS		BIGSTRING ("\x12" "defaultTimeoutSecs")
@@ -182,6 +192,8 @@ extern boolean sysos (tyvaluerecord *v); //implemted in shellsysverbs.c
 #define STR_P_POSTFILTERERROR			BIGSTRING ("\x11" "Post Filter error")
 #define STR_P_PREFILTERERROR			BIGSTRING ("\x10" "Pre filter error")
 #define STR_P_DEFAULTRESPONDER			BIGSTRING ("\x10" "defaultResponder")
+#define STR_P_KEEPALIVETIMEOUT			BIGSTRING ("\x10" "keepAliveTimeout")
+#define STR_P_PIPELINEDREQUEST			BIGSTRING ("\x10" "pipelinedRequest")
 #define STR_P_USERINETDPREFS			BIGSTRING ("\x10" "user.inetd.prefs")
 #define STR_P_RESPONSEHEADERS			BIGSTRING ("\x0F" "responseHeaders")
 #define STR_P_WHATWEREWEDOING			BIGSTRING ("\x0F" "whatWereWeDoing")
@@ -189,20 +201,39 @@ extern boolean sysos (tyvaluerecord *v); //implemted in shellsysverbs.c
 #define STR_P_ADRHEADERTABLE			BIGSTRING ("\x0E" "adrHeaderTable")
 #define STR_P_MAXCONNECTIONS			BIGSTRING ("\x0E" "maxConnections")
 #define STR_P_REQUESTHEADERS	 		BIGSTRING ("\x0E" "requestHeaders")
+#define STR_P_RESPONSESTREAM			BIGSTRING ("\x0E" "responseStream")
 #define STR_P_CONTENT_LENGTH			BIGSTRING ("\x0E" "Content-Length")
+#define STR_P_TRANSFER_ENCODING			BIGSTRING ("\x11" "Transfer-Encoding")
+#define STR_P_CONTENT_ENCODING			BIGSTRING ("\x10" "Content-Encoding")
+#define STR_P_ACCEPT_ENCODING			BIGSTRING ("\x0F" "Accept-Encoding")
+#define STR_P_CONTENT_TYPE				BIGSTRING ("\x0C" "Content-Type")
+#define STR_P_CONTENT_RANGE				BIGSTRING ("\x0D" "Content-Range")
+#define STR_P_LAST_MODIFIED				BIGSTRING ("\x0D" "Last-Modified")
+#define STR_P_ETAG						BIGSTRING ("\x04" "ETag")
+#define STR_P_VARY						BIGSTRING ("\x04" "Vary")
+#define STR_P_GZIP						BIGSTRING ("\x04" "gzip")
+#define STR_P_XGZIP						BIGSTRING ("\x06" "x-gzip")
+#define STR_P_DEFLATE					BIGSTRING ("\x07" "deflate")
+#define STR_P_IDENTITY					BIGSTRING ("\x08" "identity")
+#define STR_P_ANYCODING					BIGSTRING ("\x01" "*")
+#define STR_P_FLCOMPRESSRESPONSES		BIGSTRING ("\x13" "flCompressResponses")
+#define STR_P_COMPRESSIONTHRESHOLD		BIGSTRING ("\x14" "compressionThreshold")
 #define STR_P_WHATWENTWRONG				BIGSTRING ("\x0D" "whatWentWrong")
 #define STR_P_100CONTINUE				BIGSTRING ("\x0C" "100-continue")
 #define STR_P_RESPONSEBODY				BIGSTRING ("\x0C" "responseBody")
 #define STR_P_REQUESTBODY				BIGSTRING ("\x0B" "requestBody")
+#define STR_P_FLKEEPALIVE				BIGSTRING ("\x0B" "flKeepAlive")
 #define STR_P_MAXMEMAVAIL				BIGSTRING ("\x0B" "maxMemAvail")
 #define STR_P_MINMEMAVAIL				BIGSTRING ("\x0B" "minMemAvail")
 #define STR_P_CONNECTION				BIGSTRING ("\x0A" "Connection")
+#define STR_P_KEEPALIVE					BIGSTRING ("\x0A" "keep-alive")
 #define STR_P_PARAMTABLE 				BIGSTRING ("\x0A" "paramTable")
 #define STR_P_SEARCHARGS				BIGSTRING ("\x0A" "searchArgs")
 #define STR_P_FIRSTLINE					BIGSTRING ("\x09" "firstLine")
 #define STR_P_CHUNKSIZE					BIGSTRING ("\x09" "chunksize")
 #define STR_P_HTTP11					BIGSTRING ("\x09" "HTTP/1.1 ")
 #define STR_P_CONDITION					BIGSTRING ("\x09" "condition")
+#define STR_P_EVICTIONS					BIGSTRING ("\x09" "evictions")
 #define STR_P_RESPONDER					BIGSTRING ("\x09" "responder")
 #define STR_P_PATHARGS					BIGSTRING ("\x08" "pathArgs")
 #define STR_P_ADRTABLE					BIGSTRING ("\x08" "adrTable")
@@ -211,11 +242,13 @@ extern boolean sysos (tyvaluerecord *v); //implemted in shellsysverbs.c
 #define STR_P_REQUEST					BIGSTRING ("\x07" "request")
 #define STR_P_TIMEOUT					BIGSTRING ("\x07" "timeout")
 #define STR_P_COOKIES					BIGSTRING ("\x07" "cookies")
+#define STR_P_CHUNKED					BIGSTRING ("\x07" "chunked")
 #define STR_P_METHODS					BIGSTRING ("\x07" "methods")
 #define STR_P_FLLEGAL					BIGSTRING ("\x07" "flLegal")
 #define STR_P_FLCLOSE					BIGSTRING ("\x07" "flClose")
 #define STR_P_NOWAIT					BIGSTRING ("\x06" "noWait")
 #define STR_P_METHOD					BIGSTRING ("\x06" "method")
+#define STR_P_MISSES					BIGSTRING ("\x06" "misses")
 #define STR_P_EXPECT					BIGSTRING ("\x06" "Expect")
 #define STR_P_STREAM					BIGSTRING ("\x06" "stream")
 #define STR_P_REFCON					BIGSTRING ("\x06" "refcon")
@@ -233,6 +266,7 @@ extern boolean sysos (tyvaluerecord *v); //implemted in shellsysverbs.c
 #define STR_P_CODE						BIGSTRING ("\x04" "code")
 #define STR_P_HITS						BIGSTRING ("\x04" "hits")
 #define STR_P_HOST						BIGSTRING ("\x04" "host")
+#define STR_P_HEAD						BIGSTRING ("\x04" "HEAD")
 #define STR_P_PORT						BIGSTRING ("\x04" "port")
 #define STR_P_PATH						BIGSTRING ("\x04" "path")
 #define STR_P_DATE						BIGSTRING ("\x04" "Date")
@@ -298,6 +332,8 @@ typedef enum tyhtmlverbtoken { /*verbs that are processed by langhtml.c*/
 	
 	htmlcalendardrawfunc,
 
+	getmacrocacheinfofunc,
+
 	/* searchengine */
 
 	stripmarkupfunc,
@@ -350,6 +386,12 @@ typedef enum tyhtmlverbtoken { /*verbs that are processed by langhtml.c*/
 
 	webservergetserverstringfunc,
 
+	webserverstreamheadersfunc,
+
+	webserverstreamchunkfunc,
+
+	webserverstreamendfunc,
+
 	/* inetd */
 
 	inetdsupervisorfunc,
@@ -913,6 +955,203 @@ static boolean htmlbuildmacrocontext (typrocessmacrosinfo *pmi) {
 	} /*htmlbuildmacrocontext*/
 
 
+#pragma mark === macro cache ===
+
+/*
+compiled macros are kept in a small lru cache keyed by their source text, 
+so a site rendering the same {macro} on every page only compiles it once. 
+an item that's evicted while some thread is still running its code is 
+orphaned, and disposed when the last run releases it. a tree's nodes carry 
+the line and character errors are reported at, so each run renumbers the 
+tree for the page it's on; a macro that's already running elsewhere gets 
+a private copy instead.
+*/
+
+#define ctmacrocachemax 128		/*most compiled macros we keep around*/
+
+#define sizemacrocachemax 2048	/*larger macros are compiled but not cached*/
+
+typedef struct tymacrocacheitem {
+	
+	tyhandlecacheitem cacheitem; /*keyed by the macro's source text*/
+	
+	hdltreenode hcode;
+	
+	long ctrefs; /*number of runs currently using hcode*/
+	
+	boolean florphaned; /*not in the cache; dispose when ctrefs drops to zero*/
+	} tymacrocacheitem, *ptrmacrocacheitem, **hdlmacrocacheitem;
+
+static tyhandlecache macrocache = {ctmacrocachemax};
+
+static long ctmacrocachehits = 0;
+
+static long ctmacrocachemisses = 0;
+
+static long ctmacrocacheevictions = 0;
+
+
+static void htmldisposemacrocacheitem (hdlmacrocacheitem hitem) {
+	
+	disposehandle ((**hitem).cacheitem.hkey);
+	
+	langdisposetree ((**hitem).hcode);
+	
+	disposehandle ((Handle) hitem);
+	} /*htmldisposemacrocacheitem*/
+
+
+static void htmltrimmacrocache (void) {
+	
+	/*
+	drop least-recently used items until we're back under the limit
+	*/
+	
+	hdlhandlecacheitem h;
+	
+	while (handlecachetrim (&macrocache, &h)) {
+		
+		++ctmacrocacheevictions;
+		
+		if ((**(hdlmacrocacheitem) h).ctrefs > 0)
+			(**(hdlmacrocacheitem) h).florphaned = true;
+		else
+			htmldisposemacrocacheitem ((hdlmacrocacheitem) h);
+		}
+	} /*htmltrimmacrocache*/
+
+
+static boolean htmlgetmacrocode (Handle macro, bigstring perrorstring, hdlmacrocacheitem *hitem) {
+	
+	/*
+	return a referenced cache item holding the compiled code for macro, which 
+	we consume. the caller must balance with htmlreleasemacrocode.
+	
+	a macro we decline to cache still gets an item, orphaned from the start, 
+	so callers don't need to care.
+	*/
+	
+	unsigned long hashval = hashhandle (macro);
+	Handle hkey = nil;
+	hdltreenode hcode;
+	hdlmacrocacheitem h;
+	boolean flinuse = false;
+	
+	if (handlecachelookup (&macrocache, macro, hashval, (hdlhandlecacheitem *) &h)) {
+		
+		if ((**h).ctrefs == 0) {
+			
+			++ctmacrocachehits;
+			
+			disposehandle (macro);
+			
+			langrenumbertree ((**h).hcode); /*for this page, not the last one*/
+			
+			(**h).ctrefs = 1;
+			
+			*hitem = h;
+			
+			return (true);
+			}
+		
+		flinuse = true; /*renumbering it would throw off the run that has it*/
+		}
+	
+	++ctmacrocachemisses;
+	
+	if (!flinuse && (gethandlesize (macro) <= sizemacrocachemax))
+		copyhandle (macro, &hkey); /*failure just means we don't cache*/
+	
+	if (!langbuildtreetraperror (macro, &hcode, perrorstring)) { /*consumes macro*/
+		
+		disposehandle (hkey);
+		
+		return (false);
+		}
+	
+	langrenumbertree (hcode); /*langrunprebuilt doesn't*/
+	
+	if (!newclearhandle (sizeof (tymacrocacheitem), (Handle *) &h)) {
+		
+		disposehandle (hkey);
+		
+		langdisposetree (hcode);
+		
+		return (false);
+		}
+	
+	(**h).cacheitem.hashval = hashval;
+	
+	(**h).cacheitem.hkey = hkey;
+	
+	(**h).hcode = hcode;
+	
+	(**h).ctrefs = 1;
+	
+	if (hkey == nil)
+		(**h).florphaned = true;
+	
+	else {
+		
+		handlecacheinsert (&macrocache, (hdlhandlecacheitem) h);
+		
+		htmltrimmacrocache ();
+		}
+	
+	*hitem = h;
+	
+	return (true);
+	} /*htmlgetmacrocode*/
+
+
+static void htmlreleasemacrocode (hdlmacrocacheitem hitem) {
+	
+	if (--(**hitem).ctrefs == 0 && (**hitem).florphaned)
+		htmldisposemacrocacheitem (hitem);
+	} /*htmlreleasemacrocode*/
+
+
+static boolean htmlgetmacrocacheinfo (tyvaluerecord *v) {
+	
+	/*
+	return a record with the macro cache's counters
+	*/
+	
+	hdllistrecord hlist;
+	tyvaluerecord val;
+	
+	if (!opnewlist (&hlist, true))
+		return (false);
+	
+	setlongvalue (macrocache.ctitems, &val);
+	
+	if (!langpushlistval (hlist, STR_P_COUNT, &val))
+		goto error;
+	
+	setlongvalue (ctmacrocachehits, &val);
+	
+	if (!langpushlistval (hlist, STR_P_HITS, &val))
+		goto error;
+	
+	setlongvalue (ctmacrocachemisses, &val);
+	
+	if (!langpushlistval (hlist, STR_P_MISSES, &val))
+		goto error;
+	
+	setlongvalue (ctmacrocacheevictions, &val);
+	
+	if (!langpushlistval (hlist, STR_P_EVICTIONS, &val))
+		goto error;
+	
+	return (setheapvalue ((Handle) hlist, recordvaluetype, v));
+	
+	error:
+		opdisposelist (hlist);
+		
+		return (false);
+	} /*htmlgetmacrocacheinfo*/
+
+
 static boolean htmlrunmacro (typrocessmacrosinfo *pmi, Handle macro, bigstring perrorstring, Handle *hresult) {
 	
 	/*
@@ -939,21 +1178,35 @@ static boolean htmlrunmacro (typrocessmacrosinfo *pmi, Handle macro, bigstring p
 	5.1b21 dmb: plugged leak on error
 	
 	6.2b6 AR: If langruntraperror returns false but didn't set perrorstring, our thread has probably been killed.
+	
+	run the macro's code from the macro cache, only compiling it on a miss.
 	*/
 	
 	tyvaluerecord val;
 	boolean fl = false;
+	hdlmacrocacheitem hitem;
 	
-	if (!htmlbuildmacrocontext (pmi))
-		return (false);
+	if (!htmlbuildmacrocontext (pmi)) {
 		
-	setemptystring (perrorstring); //6.2b6 AR
+		disposehandle (macro);
+		
+		return (false);
+		}
 	
-	chainhashtable ((*pmi).hmacrocontext);
+	setemptystring (perrorstring); //6.2b6 AR
 	
-	fl = langruntraperror (macro, &val, perrorstring) && strongcoercetostring (&val) && exemptfromtmpstack (&val);
+	fl = htmlgetmacrocode (macro, perrorstring, &hitem);
 	
-	unchainhashtable ();
+	if (fl) {
+		
+		chainhashtable ((*pmi).hmacrocontext);
+		
+		fl = langrunprebuilttraperror ((**hitem).hcode, &val, perrorstring) && strongcoercetostring (&val) && exemptfromtmpstack (&val);
+		
+		unchainhashtable ();
+		
+		htmlreleasemacrocode (hitem);
+		}
 	
 	if (fl) {
 		
@@ -5540,10 +5793,11 @@ static boolean webserverbuildresponse (bigstring bscode, hdlhashtable hheadersta
 		fldisposetable = true;
 		}
 	
-	/* add Connection: close to header table */
+	/* add Connection: close to header table, unless webserverdispatch is keeping the connection alive */
 
-	if (!langassignstringvalue (hheaderstable, STR_P_CONNECTION, STR_P_CLOSE))
-		goto exit;
+	if (!hashtablesymbolexists (hheaderstable, STR_P_CONNECTION))
+		if (!langassignstringvalue (hheaderstable, STR_P_CONNECTION, STR_P_CLOSE))
+			goto exit;
 	
 	/* add Date: Sat, 29 Nov 1997 00:51:47 GMT to header table */
 	
@@ -5567,9 +5821,26 @@ static boolean webserverbuildresponse (bigstring bscode, hdlhashtable hheadersta
 
 	/* add Content-Length header if there's a response body */
 	
-	if (bodysize > 0)
+	if (bodysize > 0) {
+		
 		if (!langassignlongvalue (hheaderstable, STR_P_CONTENT_LENGTH, bodysize))
 			goto exit;
+		}
+	
+	else if (!hashtablesymbolexists (hheaderstable, STR_P_CONTENT_LENGTH) && !hashtablesymbolexists (hheaderstable, STR_P_TRANSFER_ENCODING)) { /*a kept-alive client can't wait for the close*/
+		
+		bigstring bsconnection;
+		
+		disablelangerror ();
+		
+		fl = langlookupstringvalue (hheaderstable, STR_P_CONNECTION, bsconnection);
+		
+		enablelangerror ();
+		
+		if (fl && equalidentifiers (bsconnection, STR_P_KEEPALIVE))
+			if (!langassignlongvalue (hheaderstable, STR_P_CONTENT_LENGTH, 0))
+				goto exit;
+		}
 	
 	/* loop thru the headers table and append header lines */
 	
@@ -5614,121 +5885,348 @@ exit: /* there was an error! */
 	} /*webserverbuildresponse*/
 
 
-static boolean webserveraddtoerrorlog (tyaddress *adrmethod, bigstring bstype, bigstring bserror);
+/*
+streamed responses: instead of returning the whole page, a responder can send
+the headers with webserver.streamHeaders and the body a piece at a time with
+webserver.streamChunk, so nothing more than one chunk is ever held in memory.
+HTTP/1.1 clients get Transfer-Encoding: chunked; HTTP/1.0 clients get a plain
+body ended by closing the connection. paramtable.responseStream tracks where we are.
+
+a streamed response goes out as the responder makes it, so user.webserver.postfilters
+never see it; a site that depends on its postfilters must not stream. for a HEAD
+request the headers are sent and the chunks are dropped, as there's no body to send.
+*/
 
+enum {
+	responsenotstreamed = 0,
+	responsestreamchunked,
+	responsestreamraw,
+	responsestreamended
+	};
 
-static boolean webservercallfilters (tyaddress *pta, bigstring bstable, bigstring bserrortype) {
 
-	/*
-	6.1d2 AR: A utility function for calling all scripts in a given Frontier.root table.
-	
-	6.1d4 AR: Reviewed for proper error handling and reporting.
+static long webserverresponsestream (hdlhashtable hparamtable) {
 
-	6.1d7 AR: Modified to walk the table in sorted order.
+	long state = responsenotstreamed;
+
+	disablelangerror ();
+
+	langlookuplongvalue (hparamtable, STR_P_RESPONSESTREAM, &state);
+
+	enablelangerror ();
+
+	return (state);
+	} /*webserverresponsestream*/
+
+
+static boolean webserverrequestishttp10 (hdlhashtable hparamtable) {
+
+	/*
+	look at the end of the request line; anything but HTTP/1.0 is taken to be 1.1
 	*/
 
 	tyvaluerecord val;
-	tyaddress adrscript;
-	hdlhashtable ht;
-	long i = 0;
-	hdlhashnode x;
-	bigstring bserror;
-	langerrormessagecallback savecallback;
-	ptrvoid saverefcon;
-	boolean fl;
+	hdlhashnode hnode;
+	Handle h;
+	long len;
 
-	
-	if (!langfastaddresstotable (roottable, bstable, &ht))
+	if (!hashtablelookup (hparamtable, STR_P_FIRSTLINE, &val, &hnode) || (val.valuetype != stringvaluetype))
 		return (false);
-	
-	while (hashgetnthnode (ht, i++, &x)) {
 
-		setemptystring (bserror);
-	
-		langtraperrors (bserror, &savecallback, &saverefcon);
+	h = val.data.stringvalue;
 
-		gethashkey (x, adrscript.bs);
+	len = gethandlesize (h);
 
-		adrscript.ht = ht;
+	while ((len > 0) && ((*h) [len - 1] == '\r' || (*h) [len - 1] == '\n' || (*h) [len - 1] == chspace))
+		--len;
 
-		fl = followaddress (&adrscript); /*6.1b5 AR: don't ignore return value of this call*/
-			
-		fl = fl && langcallscriptwithaddress (&adrscript, pta, nil, &val);
+	return ((len >= 8) && (memcmp (*h + len - 8, "HTTP/1.0", 8) == 0));
+	} /*webserverrequestishttp10*/
 
-		languntraperrors (savecallback, saverefcon, !fl);
 
-		fllangerror = false;
+static boolean webserverrequestishead (hdlhashtable hparamtable) {
 
-		if (!ingoodthread ())
-			return (false);
+	bigstring bsmethod;
+	boolean fl;
 
-		if (!fl && !webserveraddtoerrorlog (&adrscript, bserrortype, bserror))
-			return (false);
-		} /*while*/
-	
-	return (true);
-	} /*webservercallfilters*/
+	disablelangerror ();
 
+	fl = langlookupstringvalue (hparamtable, STR_P_METHOD, bsmethod);
 
+	enablelangerror ();
 
-#ifdef MACVERSION
-#pragma mark === kernelized webserver ===
-#endif
+	return (fl && equalstrings (bsmethod, STR_P_HEAD));
+	} /*webserverrequestishead*/
 
 
-/*	For reference: HTTP/1.1 status codes
+static boolean webserverstreamwrite (hdlhashtable hparamtable, ptrvoid p, long ct) {
 
-	Informational 1xx
-		100 Continue
-		101 Switching Protocols
-		
-	Successful 2xx
-		200 OK
-		201 Created
-		202 Accepted
-		203 Non-Authoritative Information
-		204 No Content
-		205 Reset Content
-		206 Partial Content
-		
-	Redirection 3xx
-		300 Multiple Choices
-		301 Moved Permanently
-		302 Moved Temporarily
-		303 See Other
-		304 Not Modified
-		305 Use Proxy
-		
-	Client Error 4xx
-		400 Bad Request
-		401 Unauthorized
-		402 Payment Required
-		403 Forbidden
-		404 Not Found
-		405 Method Not Allowed
-		406 Not Acceptable
-		407 Proxy Authentication Required
-		408 Request Timeout
-		409 Conflict
-		410 Gone
-		411 Length Required
-		412 Precondition Failed
-		413 Request Entity Too Large
-		414 Request-URI Too Long
-		415 Unsupported Media Type
-		
-	Server Error 5xx
-		500 Internal Server Error
-		501 Not Implemented
-		502 Bad Gateway
-		503 Service Unavailable
-		504 Gateway Timeout
-		505 HTTP Version Not Supported
-*/
+	long stream;
 
+	if (ct == 0)
+		return (true);
+
+	if (!langlookuplongvalue (hparamtable, STR_P_STREAM, &stream))
+		return (false);
+
+	return (fwsNetEventWriteStream (stream, ct, (char *) p));
+	} /*webserverstreamwrite*/
+
+
+static boolean webserverstreamheaders (hdlhashtable hparamtable) {
+
+	bigstring bscode;
+	hdlhashtable hheaderstable;
+	tyvaluerecord vheader;
+	boolean flchunked;
+	boolean fl;
+
+	if (webserverresponsestream (hparamtable) != responsenotstreamed) {
+
+		langerrormessage (STR_P_HEADERS_ALREADY_SENT);
+
+		return (false);
+		}
+
+	if (!langlookupstringvalue (hparamtable, STR_P_CODE, bscode))
+		return (false);
+
+	if (!langsuretablevalue (hparamtable, STR_P_RESPONSEHEADERS, &hheaderstable))
+		return (false);
+
+	flchunked = !webserverrequestishttp10 (hparamtable);
+
+	if (hashtablesymbolexists (hheaderstable, STR_P_CONTENT_LENGTH)) /*we don't know it yet, whatever the responder thinks*/
+		hashtabledelete (hheaderstable, STR_P_CONTENT_LENGTH);
+
+	if (flchunked)
+		fl = langassignstringvalue (hheaderstable, STR_P_TRANSFER_ENCODING, STR_P_CHUNKED);
+	else
+		fl = langassignstringvalue (hheaderstable, STR_P_CONNECTION, STR_P_CLOSE); /*the close ends the body*/
+
+	if (!fl)
+		return (false);
+
+	if (!webserverbuildresponse (bscode, hheaderstable, nil, &vheader))
+		return (false);
+
+	lockhandle (vheader.data.stringvalue);
+
+	fl = webserverstreamwrite (hparamtable, *vheader.data.stringvalue, gethandlesize (vheader.data.stringvalue));
+
+	unlockhandle (vheader.data.stringvalue);
+
+	if (!fl)
+		return (false);
+
+	return (langassignlongvalue (hparamtable, STR_P_RESPONSESTREAM, flchunked ? responsestreamchunked : responsestreamraw));
+	} /*webserverstreamheaders*/
+
+
+static boolean webserverstreamchunk (hdlhashtable hparamtable, Handle hchunk) {
+
+	long ct = gethandlesize (hchunk);
+	long state = webserverresponsestream (hparamtable);
+	char sizeline [16];
+	boolean fl;
+
+	if (state == responsenotstreamed) {
+
+		if (!webserverstreamheaders (hparamtable))
+			return (false);
+
+		state = webserverresponsestream (hparamtable);
+		}
+
+	if (state == responsestreamended) {
+
+		langerrormessage (STR_P_STREAM_ALREADY_ENDED);
+
+		return (false);
+		}
+
+	if (ct == 0) /*an empty chunk would end a chunked body*/
+		return (true);
+
+	if (webserverrequestishead (hparamtable)) /*the headers were all it asked for*/
+		return (true);
+
+	if (state == responsestreamchunked) {
+
+		sprintf (sizeline, "%lX\r\n", ct);
+
+		if (!webserverstreamwrite (hparamtable, sizeline, strlen (sizeline)))
+			return (false);
+		}
+
+	lockhandle (hchunk);
+
+	fl = webserverstreamwrite (hparamtable, *hchunk, ct);
+
+	unlockhandle (hchunk);
+
+	if (fl && (state == responsestreamchunked))
+		fl = webserverstreamwrite (hparamtable, "\r\n", 2);
+
+	return (fl);
+	} /*webserverstreamchunk*/
+
+
+static boolean webserverstreamend (hdlhashtable hparamtable) {
+
+	long state = webserverresponsestream (hparamtable);
+
+	if ((state == responsenotstreamed) || (state == responsestreamended))
+		return (true);
+
+	if ((state == responsestreamchunked) && !webserverrequestishead (hparamtable))
+		if (!webserverstreamwrite (hparamtable, "0\r\n\r\n", 5))
+			return (false);
+
+	return (langassignlongvalue (hparamtable, STR_P_RESPONSESTREAM, responsestreamended));
+	} /*webserverstreamend*/
+
+
+static boolean webserverstreamkeptalive (hdlhashtable hparamtable) {
 
-static boolean webservergetrespondertableaddress (bigstring bsname, tyaddress *adr) {
-	
+	/*
+	a finished chunked response leaves the connection usable, if we offered keep-alive
+	*/
+
+	hdlhashtable hheaderstable;
+	bigstring bsconnection;
+	boolean fl;
+
+	if (webserverresponsestream (hparamtable) != responsestreamended)
+		return (false);
+
+	disablelangerror ();
+
+	fl = langsuretablevalue (hparamtable, STR_P_RESPONSEHEADERS, &hheaderstable)
+		&& hashtablesymbolexists (hheaderstable, STR_P_TRANSFER_ENCODING)
+		&& langlookupstringvalue (hheaderstable, STR_P_CONNECTION, bsconnection);
+
+	enablelangerror ();
+
+	return (fl && equalidentifiers (bsconnection, STR_P_KEEPALIVE));
+	} /*webserverstreamkeptalive*/
+
+
+static boolean webserveraddtoerrorlog (tyaddress *adrmethod, bigstring bstype, bigstring bserror);
+
+
+static boolean webservercallfilters (tyaddress *pta, bigstring bstable, bigstring bserrortype) {
+
+	/*
+	6.1d2 AR: A utility function for calling all scripts in a given Frontier.root table.
+	
+	6.1d4 AR: Reviewed for proper error handling and reporting.
+
+	6.1d7 AR: Modified to walk the table in sorted order.
+	*/
+
+	tyvaluerecord val;
+	tyaddress adrscript;
+	hdlhashtable ht;
+	long i = 0;
+	hdlhashnode x;
+	bigstring bserror;
+	langerrormessagecallback savecallback;
+	ptrvoid saverefcon;
+	boolean fl;
+
+	
+	if (!langfastaddresstotable (roottable, bstable, &ht))
+		return (false);
+	
+	while (hashgetnthnode (ht, i++, &x)) {
+
+		setemptystring (bserror);
+	
+		langtraperrors (bserror, &savecallback, &saverefcon);
+
+		gethashkey (x, adrscript.bs);
+
+		adrscript.ht = ht;
+
+		fl = followaddress (&adrscript); /*6.1b5 AR: don't ignore return value of this call*/
+			
+		fl = fl && langcallscriptwithaddress (&adrscript, pta, nil, &val);
+
+		languntraperrors (savecallback, saverefcon, !fl);
+
+		fllangerror = false;
+
+		if (!ingoodthread ())
+			return (false);
+
+		if (!fl && !webserveraddtoerrorlog (&adrscript, bserrortype, bserror))
+			return (false);
+		} /*while*/
+	
+	return (true);
+	} /*webservercallfilters*/
+
+
+
+#ifdef MACVERSION
+#pragma mark === kernelized webserver ===
+#endif
+
+
+/*	For reference: HTTP/1.1 status codes
+
+	Informational 1xx
+		100 Continue
+		101 Switching Protocols
+		
+	Successful 2xx
+		200 OK
+		201 Created
+		202 Accepted
+		203 Non-Authoritative Information
+		204 No Content
+		205 Reset Content
+		206 Partial Content
+		
+	Redirection 3xx
+		300 Multiple Choices
+		301 Moved Permanently
+		302 Moved Temporarily
+		303 See Other
+		304 Not Modified
+		305 Use Proxy
+		
+	Client Error 4xx
+		400 Bad Request
+		401 Unauthorized
+		402 Payment Required
+		403 Forbidden
+		404 Not Found
+		405 Method Not Allowed
+		406 Not Acceptable
+		407 Proxy Authentication Required
+		408 Request Timeout
+		409 Conflict
+		410 Gone
+		411 Length Required
+		412 Precondition Failed
+		413 Request Entity Too Large
+		414 Request-URI Too Long
+		415 Unsupported Media Type
+		
+	Server Error 5xx
+		500 Internal Server Error
+		501 Not Implemented
+		502 Bad Gateway
+		503 Service Unavailable
+		504 Gateway Timeout
+		505 HTTP Version Not Supported
+*/
+
+
+static boolean webservergetrespondertableaddress (bigstring bsname, tyaddress *adr) {
+	
 	/*
 	6.1d2 AR: Determine the address of the responder table based on the given name.
 
@@ -6120,11 +6618,437 @@ static boolean webserveraddtoerrorlog (tyaddress *adrmethod, bigstring bstype, b
 	if (!langrunscript (BIGSTRING ("\x1D" "system.verbs.builtins.log.add"), &vparams, nil, &val))
 		goto exit;
 
-exit:
-	enablelangerror ();
+exit:
+	enablelangerror ();
+
+	return (true);
+	} /*webservererrorlog*/
+
+
+#if flcompressresponses
+
+/*
+response compression: when user.webserver.prefs.flCompressResponses is true, text
+responses of at least compressionThreshold bytes go out gzip or deflate encoded to
+clients whose Accept-Encoding allows it. Bodies that carry a Last-Modified or ETag
+header -- static files, cached pages -- are kept in a small cache, so a page served
+over and over is compressed once.
+*/
+
+#define defaultcompressionthreshold 1024L
+
+#define ctcompressioncacheentries 32
+
+#define maxcompressioncachebody 262144L /*don't hold on to anything bigger than this*/
+
+typedef enum tycontentencoding {
+	
+	encodingidentity = 0,
+	
+	encodinggzip,
+	
+	encodingdeflate
+	} tycontentencoding;
+
+typedef struct tycompressioncacheentry {
+	
+	tycontentencoding encoding;
+	
+	unsigned long checksum; /*adler32 of the original*/
+	
+	Handle horiginal;
+	
+	Handle hcompressed;
+	} tycompressioncacheentry;
+
+static tycompressioncacheentry compressioncache [ctcompressioncacheentries];
+
+static short ixnextcompressioncacheentry = 0;
+
+
+static boolean webservercodingrefused (bigstring bsitem) {
+	
+	/*
+	a coding is refused with a q-value of zero: q=0, q=0.0, q=0.000
+	*/
+	
+	short ix = patternmatch (BIGSTRING ("\x02" "q="), bsitem);
+	short len = stringlength (bsitem);
+	
+	if (ix == 0)
+		return (false);
+	
+	for (ix = ix + 1; ix < len; ix++) { /*patternmatch is one-based, getstringcharacter zero-based*/
+		
+		byte ch = getstringcharacter (bsitem, ix);
+		
+		if ((ch != '0') && (ch != '.') && (ch != chspace))
+			return (false);
+		}
+	
+	return (true);
+	} /*webservercodingrefused*/
+
+
+static tycontentencoding webserveracceptedencoding (hdlhashtable hparamtable, boolean *flidentityrefused) {
+	
+	/*
+	pick a coding from the request's Accept-Encoding header, gzip before deflate.
+	
+	a coding the header doesn't name is acceptable if "*" is. identity is 
+	acceptable unless it's refused by name, or "*" is refused and identity 
+	isn't named; in that case *flidentityrefused is true, and our caller 
+	should compress whatever it can.
+	*/
+	
+	hdlhashtable hheaderstable;
+	bigstring bsaccept, bsitem, bscoding;
+	boolean flgzip = false, flgzipnamed = false;
+	boolean fldeflate = false, fldeflatenamed = false;
+	boolean flidentity = true, flidentitynamed = false;
+	boolean flany = false, flanynamed = false;
+	boolean fl;
+	short ix;
+	
+	*flidentityrefused = false;
+	
+	disablelangerror ();
+	
+	fl = langsuretablevalue (hparamtable, STR_P_REQUESTHEADERS, &hheaderstable)
+		&& langlookupstringvalue (hheaderstable, STR_P_ACCEPT_ENCODING, bsaccept);
+	
+	enablelangerror ();
+	
+	if (!fl)
+		return (encodingidentity);
+	
+	for (ix = 1; nthfield (bsaccept, ix, ',', bsitem); ix++) {
+		
+		popleadingchars (bsitem, chspace);
+		
+		alllower (bsitem);
+		
+		firstword (bsitem, ';', bscoding);
+		
+		poptrailingwhitespace (bscoding);
+		
+		if (equalstrings (bscoding, STR_P_GZIP) || equalstrings (bscoding, STR_P_XGZIP)) {
+			
+			flgzip = !webservercodingrefused (bsitem);
+			
+			flgzipnamed = true;
+			}
+		
+		else if (equalstrings (bscoding, STR_P_DEFLATE)) {
+			
+			fldeflate = !webservercodingrefused (bsitem);
+			
+			fldeflatenamed = true;
+			}
+		
+		else if (equalstrings (bscoding, STR_P_IDENTITY)) {
+			
+			flidentity = !webservercodingrefused (bsitem);
+			
+			flidentitynamed = true;
+			}
+		
+		else if (equalstrings (bscoding, STR_P_ANYCODING)) {
+			
+			flany = !webservercodingrefused (bsitem);
+			
+			flanynamed = true;
+			}
+		}
+	
+	if (!flgzipnamed)
+		flgzip = flany;
+	
+	if (!fldeflatenamed)
+		fldeflate = flany;
+	
+	if (!flidentitynamed && flanynamed)
+		flidentity = flany;
+	
+	*flidentityrefused = !flidentity;
+	
+	if (flgzip)
+		return (encodinggzip);
+	
+	if (fldeflate)
+		return (encodingdeflate);
+	
+	return (encodingidentity);
+	} /*webserveracceptedencoding*/
+
+
+static boolean webservercompressibletype (hdlhashtable hheaderstable) {
+	
+	/*
+	only text is worth compressing; images and archives are compressed already
+	*/
+	
+	bigstring bstype;
+	boolean fl;
+	
+	disablelangerror ();
+	
+	fl = langlookupstringvalue (hheaderstable, STR_P_CONTENT_TYPE, bstype);
+	
+	enablelangerror ();
+	
+	if (!fl)
+		return (false);
+	
+	alllower (bstype);
+	
+	return ((patternmatch (BIGSTRING ("\x05" "text/"), bstype) == 1)
+		|| (patternmatch (BIGSTRING ("\x03" "xml"), bstype) > 0)
+		|| (patternmatch (BIGSTRING ("\x0A" "javascript"), bstype) > 0)
+		|| (patternmatch (BIGSTRING ("\x04" "json"), bstype) > 0));
+	} /*webservercompressibletype*/
+
+
+static boolean webserverdeflatehandle (Handle hbody, tycontentencoding encoding, boolean flevenifbigger, Handle *hcompressed) {
+	
+	/*
+	compress hbody in one go into a new handle. return false if zlib fails or,
+	unless flevenifbigger is true, if the result isn't any smaller, in which 
+	case there's nothing to send but hbody.
+	*/
+	
+	long ctbody = gethandlesize (hbody);
+	z_stream zs;
+	uLong ctbound;
+	int err;
+	
+	*hcompressed = nil;
+	
+	clearbytes (&zs, sizeof (zs));
+	
+	if (deflateInit2 (&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, (encoding == encodinggzip) ? MAX_WBITS + 16 : MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return (false);
+	
+	ctbound = deflateBound (&zs, ctbody);
+	
+	if (!newhandle (ctbound, hcompressed)) {
+		
+		deflateEnd (&zs);
+		
+		return (false);
+		}
+	
+	lockhandle (hbody);
+	
+	lockhandle (*hcompressed);
+	
+	zs.next_in = (Bytef *) *hbody;
+	
+	zs.avail_in = ctbody;
+	
+	zs.next_out = (Bytef *) **hcompressed;
+	
+	zs.avail_out = ctbound;
+	
+	err = deflate (&zs, Z_FINISH);
+	
+	unlockhandle (*hcompressed);
+	
+	unlockhandle (hbody);
+	
+	deflateEnd (&zs);
+	
+	if ((err != Z_STREAM_END) || (!flevenifbigger && ((long) zs.total_out >= ctbody)) || !sethandlesize (*hcompressed, zs.total_out)) {
+		
+		disposehandle (*hcompressed);
+		
+		*hcompressed = nil;
+		
+		return (false);
+		}
+	
+	return (true);
+	} /*webserverdeflatehandle*/
+
+
+static boolean webserverfindcompressedbody (Handle hbody, tycontentencoding encoding, unsigned long checksum, Handle *hcompressed) {
+	
+	short ix;
+	
+	for (ix = 0; ix < ctcompressioncacheentries; ix++) {
+		
+		tycompressioncacheentry *pentry = &compressioncache [ix];
+		
+		if (((*pentry).horiginal == nil) || ((*pentry).encoding != encoding) || ((*pentry).checksum != checksum))
+			continue;
+		
+		if (!equalhandles ((*pentry).horiginal, hbody)) /*a checksum collision*/
+			continue;
+		
+		return (copyhandle ((*pentry).hcompressed, hcompressed));
+		}
+	
+	return (false);
+	} /*webserverfindcompressedbody*/
+
+
+static void webservercachecompressedbody (Handle hbody, tycontentencoding encoding, unsigned long checksum, Handle hcompressed) {
+	
+	/*
+	replace the oldest entry; if we run out of memory the body just isn't cached
+	*/
+	
+	tycompressioncacheentry *pentry = &compressioncache [ixnextcompressioncacheentry];
+	Handle horiginal, hcopy;
+	
+	if (gethandlesize (hbody) > maxcompressioncachebody)
+		return;
+	
+	if (!copyhandle (hbody, &horiginal))
+		return;
+	
+	if (!copyhandle (hcompressed, &hcopy)) {
+		
+		disposehandle (horiginal);
+		
+		return;
+		}
+	
+	disposehandle ((*pentry).horiginal);
+	
+	disposehandle ((*pentry).hcompressed);
+	
+	(*pentry).encoding = encoding;
+	
+	(*pentry).checksum = checksum;
+	
+	(*pentry).horiginal = horiginal;
+	
+	(*pentry).hcompressed = hcopy;
+	
+	ixnextcompressioncacheentry = (ixnextcompressioncacheentry + 1) % ctcompressioncacheentries;
+	} /*webservercachecompressedbody*/
+
+
+static boolean webservertagencodedetag (hdlhashtable hheaderstable, tycontentencoding encoding) {
+	
+	/*
+	the compressed body is a different representation from the one the ETag 
+	was made for, so it mustn't carry the same tag; a cache or a client 
+	revalidating with If-Match would mix the two up. add the coding to the 
+	tag, inside its quotes, keeping it weak if it was: "abc" becomes 
+	"abc-gzip" and W/"abc" becomes W/"abc-gzip".
+	*/
+	
+	bigstring bsetag;
+	boolean fl;
+	
+	disablelangerror ();
+	
+	fl = langlookupstringvalue (hheaderstable, STR_P_ETAG, bsetag);
+	
+	enablelangerror ();
+	
+	if (!fl) /*no tag, nothing to do*/
+		return (true);
+	
+	if ((stringlength (bsetag) > 0) && (lastchar (bsetag) == '"'))
+		setstringlength (bsetag, stringlength (bsetag) - 1);
+	else
+		insertchar ('"', bsetag); /*wasn't quoted*/
+	
+	pushchar ('-', bsetag);
+	
+	pushstring ((encoding == encodinggzip) ? STR_P_GZIP : STR_P_DEFLATE, bsetag);
+	
+	pushchar ('"', bsetag);
+	
+	return (langassignstringvalue (hheaderstable, STR_P_ETAG, bsetag));
+	} /*webservertagencodedetag*/
+
 
+static boolean webservercompressresponse (hdlhashtable hparamtable, hdlhashtable hheaderstable, Handle hbody, Handle *hencoded) {
+	
+	/*
+	if the response qualifies and the client accepts it, set *hencoded to the
+	compressed body and add Content-Encoding to the response headers. *hencoded is
+	nil if the body goes out as is. failing to compress isn't an error; failing
+	to set a header is.
+	
+	a client that refuses identity gets its body compressed whatever its size. 
+	if we can't compress it, it goes out as is rather than as a 406.
+	*/
+	
+	tyvaluerecord val;
+	long threshold = defaultcompressionthreshold;
+	tycontentencoding encoding;
+	unsigned long checksum;
+	boolean flcacheable;
+	boolean flidentityrefused;
+	
+	*hencoded = nil;
+	
+	if (!webservergetpref (STR_P_FLCOMPRESSRESPONSES, &val) || !coercetoboolean (&val) || !val.data.flvalue)
+		return (true);
+	
+	if (hashtablesymbolexists (hheaderstable, STR_P_CONTENT_ENCODING) || hashtablesymbolexists (hheaderstable, STR_P_CONTENT_RANGE))
+		return (true);
+	
+	if (!webservercompressibletype (hheaderstable))
+		return (true);
+	
+	/* from here on the response depends on Accept-Encoding, so caches must know */
+	
+	if (!hashtablesymbolexists (hheaderstable, STR_P_VARY))
+		if (!langassignstringvalue (hheaderstable, STR_P_VARY, STR_P_ACCEPT_ENCODING))
+			return (false);
+	
+	encoding = webserveracceptedencoding (hparamtable, &flidentityrefused);
+	
+	if (encoding == encodingidentity)
+		return (true);
+	
+	if (!flidentityrefused) {
+		
+		if (webservergetpref (STR_P_COMPRESSIONTHRESHOLD, &val) && coercetolong (&val))
+			threshold = val.data.longvalue;
+		
+		if (gethandlesize (hbody) < max (threshold, 1))
+			return (true);
+		}
+	
+	lockhandle (hbody);
+	
+	checksum = adler32 (adler32 (0L, Z_NULL, 0), (Bytef *) *hbody, gethandlesize (hbody));
+	
+	unlockhandle (hbody);
+	
+	if (!webserverfindcompressedbody (hbody, encoding, checksum, hencoded)) {
+		
+		if (!webserverdeflatehandle (hbody, encoding, flidentityrefused, hencoded))
+			return (true);
+		
+		flcacheable = hashtablesymbolexists (hheaderstable, STR_P_LAST_MODIFIED)
+			|| hashtablesymbolexists (hheaderstable, STR_P_ETAG);
+		
+		if (flcacheable && (gethandlesize (*hencoded) < gethandlesize (hbody))) /*a bigger one is only for clients that insist*/
+			webservercachecompressedbody (hbody, encoding, checksum, *hencoded);
+		}
+	
+	if (!langassignstringvalue (hheaderstable, STR_P_CONTENT_ENCODING, (encoding == encodinggzip) ? STR_P_GZIP : STR_P_DEFLATE)
+		|| !webservertagencodedetag (hheaderstable, encoding)) {
+		
+		disposehandle (*hencoded);
+		
+		*hencoded = nil;
+		
+		return (false);
+		}
+	
 	return (true);
-	} /*webservererrorlog*/
+	} /*webservercompressresponse*/
+
+#endif
 
 
 static boolean webservercallresponder (tyaddress *pta, tyaddress *adrresponder, tyvaluerecord *vreturn) {
@@ -6135,6 +7059,9 @@ static boolean webservercallresponder (tyaddress *pta, tyaddress *adrresponder,
 	6.1d4 AR: Reviewed for proper error handling and reporting.
 	
 	6.2b10 AR: Implemented writing of file to stream.
+	
+	a responder that streamed its response has already sent it, so the 
+	postfilters don't run for it.
 	*/
 
 	tyaddress adrscript;
@@ -6168,6 +7095,16 @@ static boolean webservercallresponder (tyaddress *pta, tyaddress *adrresponder,
 	if (!langcallscriptwithaddress (&adrscript, pta, nil, vreturn))
 		goto internal_error;
 	
+	/* a responder that streamed its response has already sent everything but the end; too late for postfilters */
+	
+	if (webserverresponsestream (hparamtable) != responsenotstreamed) {
+		
+		if (!webserverstreamend (hparamtable) || !setstringvalue (emptystring, vreturn))
+			goto internal_error;
+		
+		goto done;
+		}
+	
 	/* build response if neccessary */
 	
 	if (((*vreturn).valuetype == booleanvaluetype) && ((*vreturn).data.flvalue == true)) {
@@ -6175,6 +7112,10 @@ static boolean webservercallresponder (tyaddress *pta, tyaddress *adrresponder,
 		tyvaluerecord val;
 		bigstring bscode;
 		hdlhashtable hresponseheaderstable;
+#if flcompressresponses
+		Handle hencoded;
+		boolean fl;
+#endif
 		
 		/* run post-filters */
 		
@@ -6236,11 +7177,23 @@ static boolean webservercallresponder (tyaddress *pta, tyaddress *adrresponder,
 		if (!copyvaluerecord (val, &val) || !coercetostring (&val))
 			goto internal_error;
 
+#if flcompressresponses
+		if (!webservercompressresponse (hparamtable, hresponseheaderstable, val.data.stringvalue, &hencoded))
+			goto internal_error;
+
+		fl = webserverbuildresponse (bscode, hresponseheaderstable, (hencoded != nil) ? hencoded : val.data.stringvalue, vreturn);
+
+		disposehandle (hencoded);
+
+		if (!fl)
+			goto internal_error;
+#else
 		if (!webserverbuildresponse (bscode, hresponseheaderstable, val.data.stringvalue, vreturn))
 			goto internal_error;
+#endif
 		}
 
-/*done:*/
+done:
 
 	languntraperrors (savecallback, saverefcon, false);
 
@@ -6270,6 +7223,11 @@ internal_error: {
 
 		langreleasesemaphores (nil);
 
+		/* too late for an error page if part of the response is out; let inetd drop the connection */
+
+		if (webserverresponsestream (hparamtable) != responsenotstreamed)
+			return (false);
+
 		/* webserver.util.buildResponse (500, nil, webserver.util.buildErrorPage ("500 Server Error", tryError)) */
 
 		numbertostring (500L, bscode);
@@ -6291,6 +7249,47 @@ internal_error: {
 	} /*webservercallresponder*/
 
 
+static boolean webserverwantskeepalive (hdlhashtable hparamtable) {
+
+	/*
+	Keep the connection open if inetdsupervisor offered to (flKeepAlive) and
+	the client wants it: HTTP/1.1 unless it said Connection: close, HTTP/1.0
+	only if it said Connection: keep-alive.
+	*/
+	
+	hdlhashtable hheaderstable;
+	bigstring bsconnection;
+	boolean flkeepalive = false;
+	boolean flhttp10;
+	boolean flgotconnection;
+	
+	disablelangerror ();
+	
+	langlookupbooleanvalue (hparamtable, STR_P_FLKEEPALIVE, &flkeepalive);
+	
+	enablelangerror ();
+	
+	if (!flkeepalive)
+		return (false);
+	
+	flhttp10 = webserverrequestishttp10 (hparamtable);
+	
+	if (!langsuretablevalue (hparamtable, STR_P_REQUESTHEADERS, &hheaderstable))
+		return (false);
+	
+	disablelangerror ();
+	
+	flgotconnection = langlookupstringvalue (hheaderstable, STR_P_CONNECTION, bsconnection);
+	
+	enablelangerror ();
+	
+	if (flhttp10)
+		return (flgotconnection && equalidentifiers (bsconnection, STR_P_KEEPALIVE));
+	
+	return (!flgotconnection || !equalidentifiers (bsconnection, STR_P_CLOSE));
+	} /*webserverwantskeepalive*/
+
+
 static boolean webserverdispatch (tyaddress *pta, tyvaluerecord *vreturn) {
 
 	/*
@@ -6341,12 +7340,48 @@ static boolean webserverdispatch (tyaddress *pta, tyvaluerecord *vreturn) {
 	if (!langassignnewtablevalue (hparamtable, STR_P_RESPONSEHEADERS, &hresponseheaderstable))
 		return (false);
 
+	if (webserverwantskeepalive (hparamtable))
+		if (!langassignstringvalue (hresponseheaderstable, STR_P_CONNECTION, STR_P_KEEPALIVE))
+			return (false);
+
 	/* call responder, run postfilters, and build response */		
 
 	return (webservercallresponder (pta, &adrresponder, vreturn));
 	} /*webserverdispatch*/
 	
 
+static boolean webserversplitpipelined (hdlhashtable ht, Handle h, long ctrequest, boolean flkeep) {
+
+	/*
+	h holds a ctrequest byte request, possibly followed by the start of the
+	next one if a keep-alive client didn't wait for our response. Cut that off
+	and, if flkeep, leave it in the paramtable for inetdsupervisor.
+	*/
+	
+	Handle hnext;
+	long ix = ctrequest;
+	long ctextra = gethandlesize (h) - ctrequest;
+	
+	if (ctextra <= 0)
+		return (true);
+	
+	if (flkeep) {
+		
+		if (!loadfromhandletohandle (h, &ix, ctextra, false, &hnext))
+			return (false);
+		
+		if (!langassigntextvalue (ht, STR_P_PIPELINEDREQUEST, hnext)) {
+			
+			disposehandle (hnext);
+			
+			return (false);
+			}
+		}
+	
+	return (sethandlesize (h, ctrequest));
+	} /*webserversplitpipelined*/
+
+
 static boolean webserverreadrequest (hdlhashtable ht, Handle h, long *errorcode, bigstring bserror) {
 
 	/*
@@ -6356,6 +7391,10 @@ static boolean webserverreadrequest (hdlhashtable ht, Handle h, long *errorcode,
 	6.1d4 AR: Reviewed for proper error handling and reporting.
 
 	6.1b9 AR: Adapted to fwsNetEventsReadStreamUntil changes.
+	
+	When reading from the stream, start with whatever inetdsupervisor carried
+	over from the last request on this connection, and hand back anything we
+	read past the end of this one.
 	*/
 
 	hdlhashtable hheaderstable;
@@ -6366,7 +7405,10 @@ static boolean webserverreadrequest (hdlhashtable ht, Handle h, long *errorcode,
 	long stream = -1;
 	long timeout = 30;
 	boolean flresult = false;
+	boolean flfromstream = false;
 	boolean fl;
+	tyvaluerecord val;
+	hdlhashnode hnode;
 
 	/* Try to lookup stream and timeout in paramtable */
 
@@ -6389,8 +7431,19 @@ static boolean webserverreadrequest (hdlhashtable ht, Handle h, long *errorcode,
 		}
 	else { /* Read headers*/
 
-		if (!newemptyhandle (&h))
-			goto exit;
+		flfromstream = true;
+		
+		if (hashtablelookup (ht, STR_P_PIPELINEDREQUEST, &val, &hnode) && (val.valuetype == stringvaluetype)) {
+			
+			if (!copyhandle (val.data.stringvalue, &h))
+				goto exit;
+			
+			hashtabledelete (ht, STR_P_PIPELINEDREQUEST);
+			}
+		else {
+			if (!newemptyhandle (&h))
+				goto exit;
+			}
 
 		if (!fwsNetEventReadStreamUntil (stream, h, hpattern, timeout))
 			goto exit;
@@ -6481,9 +7534,7 @@ static boolean webserverreadrequest (hdlhashtable ht, Handle h, long *errorcode,
 			goto exit;
 			}
 
-		ctrequest = gethandlesize (h);
-
-		if (ctrequest > ctfullrequest && !sethandlesize (h, ctfullrequest)) /* remove trailing junk */
+		if (!webserversplitpipelined (ht, h, ctfullrequest, flfromstream)) /* remove trailing junk */
 			goto exit;
 		
 		ixbodystart = ctheaders + ctpattern;
@@ -6491,6 +7542,15 @@ static boolean webserverreadrequest (hdlhashtable ht, Handle h, long *errorcode,
 		if (!loadfromhandletohandle (h, &ixbodystart, contentlength, false, &hrequestbody))
 			goto exit;
 		}
+	
+	else if (flfromstream) { /* no body; anything after the headers belongs to the next request */
+		
+		long ctheaders = searchhandle (h, hpattern, 0, gethandlesize (h));
+		
+		if (ctheaders >= 0)
+			if (!webserversplitpipelined (ht, h, ctheaders + gethandlesize (hpattern), true))
+				goto exit;
+		}
 
 	/* Check for Expect header -- we may not be able to live up to the client's expectations */
 
@@ -7035,12 +8095,95 @@ static boolean inetdaddtoerrorlog (long code, bigstring bserror, hdlhashtable hp
 	} /*inetdaddtoerrorlog*/
 
 
+static boolean inetdresponsekeepsalive (Handle hresponse) {
+
+	/*
+	did the daemon's response say Connection: keep-alive? only our own
+	webserverdispatch says so, and only when we offered via flKeepAlive.
+	*/
+	
+	Handle hpattern = nil;
+	long ixheadersend;
+	boolean fl = false;
+	
+	if (!newtexthandle (STR_P_CRLFCRLF, &hpattern))
+		return (false);
+	
+	ixheadersend = searchhandle (hresponse, hpattern, 0, gethandlesize (hresponse));
+	
+	disposehandle (hpattern);
+	
+	if (ixheadersend < 0)
+		return (false);
+	
+	if (!newtexthandle (BIGSTRING ("\x18" "\r\nConnection: keep-alive"), &hpattern))
+		return (false);
+	
+	fl = searchhandleunicase (hresponse, hpattern, 0, ixheadersend + 2) >= 0;
+	
+	disposehandle (hpattern);
+	
+	return (fl);
+	} /*inetdresponsekeepsalive*/
+
+
+static boolean inetdwaitfornextrequest (long stream, hdlhashtable hparamtable, long timeout, Handle *hnext) {
+
+	/*
+	wait up to timeout seconds for the headers of the next request on a 
+	kept-alive connection, starting with whatever the last request read past 
+	its end. false if the client went away or stayed idle.
+	*/
+	
+	Handle hpattern = nil;
+	tyvaluerecord val;
+	hdlhashnode hnode;
+	boolean fl;
+	
+	if (hashtablelookup (hparamtable, STR_P_PIPELINEDREQUEST, &val, &hnode) && (val.valuetype == stringvaluetype)) {
+		
+		if (!copyhandle (val.data.stringvalue, hnext))
+			return (false);
+		}
+	else {
+		if (!newemptyhandle (hnext))
+			return (false);
+		}
+	
+	if (!newtexthandle (STR_P_CRLFCRLF, &hpattern)) {
+		
+		disposehandle (*hnext);
+		
+		return (false);
+		}
+	
+	fl = fwsNetEventReadStreamUntil (stream, *hnext, hpattern, timeout);
+	
+	disposehandle (hpattern);
+	
+	if (!fl) {
+		
+		disposehandle (*hnext);
+		
+		*hnext = nil;
+		}
+	
+	return (fl);
+	} /*inetdwaitfornextrequest*/
+
+
 static boolean inetdsupervisor (long stream, long refcon, tyvaluerecord * vreturn) {
 
 	/*
 	6.1d1 AR: The entry point for the kernelized webserver.
 	
 	6.1d4 AR: Reviewed for proper error handling and reporting.
+	
+	HTTP/1.1 keep-alive: when the daemon doesn't read the request itself (noWait),
+	we tell the webserver it may keep the connection (flKeepAlive). If the response 
+	says it did, we wait keepAliveTimeout seconds for the next request's headers 
+	and go around again, up to maxKeepAliveRequests per connection. Both settings 
+	come from the daemon's config table or user.inetd.prefs.
 	*/
 	
 	hdlhashtable hparamtable = nil;
@@ -7062,6 +8205,11 @@ static boolean inetdsupervisor (long stream, long refcon, tyvaluerecord * vretur
 	tyaddress adrscript;
 	boolean flGotTimeout, flGotChunksize;
 	boolean flNoWait = false;
+	boolean flkeepalive = false;
+	long keepalivetimeout = 15; /*seconds*/
+	long maxkeepaliverequests = 100;
+	long ctrequests = 0;
+	Handle hpipelined = nil;
 	hdlhashnode hnode;
 
 	/* check for valid stream id */
@@ -7075,6 +8223,10 @@ static boolean inetdsupervisor (long stream, long refcon, tyvaluerecord * vretur
 	
 	langtraperrors (bserror, &savecallback, &saverefcon);
 
+nextrequest:
+
+	whatarewedoing = 0;
+
 	/* check user.inetd.shutdown flag */
 
 	if (langgetuserflag (idinetdshutdown, false)) {
@@ -7189,6 +8341,20 @@ static boolean inetdsupervisor (long stream, long refcon, tyvaluerecord * vretur
 	if (!langassignlongvalue (hparamtable, STR_P_TIMEOUT, timeout))
 		goto exit;
 
+	/* keep-alive settings, which older configurations don't have */
+
+	disablelangerror ();
+
+	if (!langlookuplongvalue (hconfigtable, STR_P_KEEPALIVETIMEOUT, &keepalivetimeout))
+		if (langfastaddresstotable (roottable, STR_P_USERINETDPREFS, &hprefstable))
+			langlookuplongvalue (hprefstable, STR_P_KEEPALIVETIMEOUT, &keepalivetimeout);
+
+	if (!langlookuplongvalue (hconfigtable, STR_P_MAXKEEPALIVEREQUESTS, &maxkeepaliverequests))
+		if (langfastaddresstotable (roottable, STR_P_USERINETDPREFS, &hprefstable))
+			langlookuplongvalue (hprefstable, STR_P_MAXKEEPALIVEREQUESTS, &maxkeepaliverequests);
+
+	enablelangerror ();
+
 	/*  waiting for data & init more paramtable values: request */
 
 	whatarewedoing++;
@@ -7211,6 +8377,26 @@ static boolean inetdsupervisor (long stream, long refcon, tyvaluerecord * vretur
 
 	enablelangerror ();
 
+	flkeepalive = flNoWait && (ctrequests + 1 < maxkeepaliverequests);
+
+	if (flkeepalive)
+		if (!langassignbooleanvalue (hparamtable, STR_P_FLKEEPALIVE, true))
+			goto exit;
+
+	if (hpipelined != nil) { /*headers of this request, read while waiting on the connection*/
+
+		if (!langassigntextvalue (hparamtable, STR_P_PIPELINEDREQUEST, hpipelined)) {
+
+			disposehandle (hpipelined);
+
+			hpipelined = nil;
+
+			goto exit;
+			}
+
+		hpipelined = nil;
+		}
+
 	if (!flNoWait) {
 
 		if (!fwsNetEventInetdRead (stream, hrequest, timeout))
@@ -7245,15 +8431,42 @@ static boolean inetdsupervisor (long stream, long refcon, tyvaluerecord * vretur
 		if (!fwsNetEventWriteHandleToStream (stream, vreturndata.data.stringvalue, chunksize, timeout))
 			goto exit;
 
-	/* it's the end of the world as we know it */
+	/* it's the end of the world as we know it -- unless the client is staying */
 	
 	whatarewedoing++;
 
+	if (flkeepalive && (vreturndata.valuetype == stringvaluetype) && (inetdresponsekeepsalive (vreturndata.data.stringvalue) || webserverstreamkeptalive (hparamtable))) {
+
+		exemptfromtmpstack (&vreturndata); /*don't let responses pile up on a long connection*/
+
+		disposevaluerecord (vreturndata, false);
+
+		if (inetdwaitfornextrequest (stream, hparamtable, keepalivetimeout, &hpipelined)) {
+
+			++ctrequests;
+
+			goto nextrequest;
+			}
+
+		if (!ingoodthread ())
+			goto exit;
+
+		/* idle too long or the client hung up, neither is worth logging */
+
+		fwsNetEventCloseStream (stream);
+
+		fllangerror = false;
+
+		goto done;
+		}
+
 	if (!fwsNetEventCloseStream (stream))
 		goto exit; /* On Mac OS: error -51 (bad refnum) -- WHY??? */
 
 done:
 
+	disposehandle (hpipelined);
+
 	languntraperrors (savecallback, saverefcon, false);
 
 	setbooleanvalue (true, vreturn);
@@ -7262,6 +8475,8 @@ done:
 
 exit:
 
+	disposehandle (hpipelined);
+
 	languntraperrors (savecallback, saverefcon, true);
 
 	fllangerror = false; /*6.1b12 AR*/
@@ -10368,6 +11583,12 @@ static boolean htmlfunctionvalue (short token, hdltreenode hparam1, tyvaluerecor
 		case htmlcalendardrawfunc:
 			return (htmlcalendardrawverb (hp1, v));
 
+		case getmacrocacheinfofunc:
+			if (!langcheckparamcount (hp1, 0))
+				return (false);
+			
+			return (htmlgetmacrocacheinfo (v));
+
 		/*webserver*/
 
 		case webserverserverfunc: {
@@ -10498,6 +11719,47 @@ static boolean htmlfunctionvalue (short token, hdltreenode hparam1, tyvaluerecor
 			return (webservergetserverstring (v));
 			}
 
+		case webserverstreamheadersfunc:
+		case webserverstreamendfunc: {
+			hdlhashtable hparamtable;
+
+			flnextparamislast = true;
+
+			if (!gettablevalue (hp1, 1, &hparamtable))
+				return (false);
+
+			if (token == webserverstreamheadersfunc) {
+
+				if (!webserverstreamheaders (hparamtable))
+					return (false);
+				}
+			else {
+
+				if (!webserverstreamend (hparamtable))
+					return (false);
+				}
+
+			return (setbooleanvalue (true, v));
+			}
+
+		case webserverstreamchunkfunc: {
+			hdlhashtable hparamtable;
+			Handle hchunk;
+
+			if (!gettablevalue (hp1, 1, &hparamtable))
+				return (false);
+
+			flnextparamislast = true;
+
+			if (!getreadonlytextvalue (hp1, 2, &hchunk))
+				return (false);
+
+			if (!webserverstreamchunk (hparamtable, hchunk))
+				return (false);
+
+			return (setbooleanvalue (true, v));
+			}
+
 		/*inetd*/
 		
 		case inetdsupervisorfunc: {
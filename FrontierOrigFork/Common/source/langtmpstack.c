@@ -36,9 +36,48 @@
 
 
 
-#define ctgrowtmpstack 5 /*amount to grow tmpstack by when full*/
+#define ctgrowtmpstack 8 /*minimum amount to grow tmpstack by when full*/
 
 
+/*
+the tmpstack is used as a stack: temps are pushed on top, and since the 
+value being exempted is almost always one of the most recent, searches 
+work down from the top. holes left by exempted temps are popped when they 
+reach the top, squeezed out when the stack fills, and otherwise wait for 
+cleartmpstack, which only has to visit the slots in use.
+*/
+
+
+static void poptmpstackholes (hdlhashtable ht) {
+	
+	register short ct = (**ht).cttmpinuse;
+	register tyvaluerecord *p = (**ht).tmpstack + ct;
+	
+	while (ct > 0 && (*--p).valuetype == novaluetype)
+		--ct;
+	
+	(**ht).cttmpinuse = ct;
+	} /*poptmpstackholes*/
+
+
+static void compacttmpstack (hdlhashtable ht) {
+	
+	register tyvaluerecord *psource = (**ht).tmpstack;
+	register tyvaluerecord *pdest = psource;
+	register short ctloops;
+	
+	for (ctloops = (**ht).cttmpinuse; ctloops--; ++psource) {
+		
+		if ((*psource).valuetype != novaluetype)
+			*pdest++ = *psource;
+		}
+	
+	(**ht).cttmpinuse = pdest - (**ht).tmpstack;
+	
+	for (ctloops = psource - pdest; ctloops--; ++pdest)
+		initvalue (pdest, novaluetype);
+	} /*compacttmpstack*/
+
 
 void cleartmpstack (void) {
 
@@ -58,6 +97,8 @@ void cleartmpstack (void) {
 	know that you will not be using any of the temporaries in the stack.
 	
 	1/8/91 dmb: check currenthashtable for nil
+	
+	only the slots in use need visiting; everything above them is empty.
 	*/
 	
 	register short ctloops;
@@ -70,7 +111,7 @@ void cleartmpstack (void) {
 	
 	p = (**currenthashtable).tmpstack;
 	
-	for (ctloops = (**currenthashtable).cttmpstack; ctloops--; ++p) { /*step through tmpstack*/
+	for (ctloops = (**currenthashtable).cttmpinuse; ctloops--; ++p) { /*step through tmpstack*/
 		
 		if ((*p).valuetype != novaluetype) {
 			
@@ -81,7 +122,9 @@ void cleartmpstack (void) {
 			initvalue (p, novaluetype);
 			}
 		} /*for*/
-		
+	
+	(**currenthashtable).cttmpinuse = 0;
+	
 	unlockhandle ((Handle) currenthashtable);
 	} /*cleartmpstack*/
 
@@ -92,43 +135,47 @@ boolean pushtmpstackvalue (tyvaluerecord *vpush) {
 	1/14/91 dmb: check currenthashtable for nil.  this might happen when 
 	setstringvalue or copyvaluerecord is called outside of language 
 	execution.  in these situations, the caller should be managing the memory.
+	
+	push on top of the stack. when it's full, squeeze out the holes if that 
+	frees a good part of it; otherwise double its size.
 	*/
 	
-	register short ctloops;
-	register tyvaluerecord *p;
+	register hdlhashtable ht = currenthashtable;
+	register short ctslots;
 	
 	if ((*vpush).data.binaryvalue == nil) /*nothing to push*/
 		return (true);
 	
-	if (currenthashtable == nil) /*not an error, but caller must handle disposal*/
+	if (ht == nil) /*not an error, but caller must handle disposal*/
 		return (true);
 	
 	assert (validhandle ((*vpush).data.stringvalue));
 	
-	p = (**currenthashtable).tmpstack;
-	
-	for (ctloops = (**currenthashtable).cttmpstack; ctloops--; ++p) { /*step through tmpstack*/
+	ctslots = (**ht).cttmpstack;
 	
-		if ((*p).valuetype == novaluetype) { /*found an empty slot in tmpstack*/
+	if ((**ht).cttmpinuse == ctslots) {
+		
+		compacttmpstack (ht);
+		
+		if ((**ht).cttmpinuse >= ctslots - ctslots / 4) { /*still mostly full*/
 			
-			(*vpush).fltmpstack = true;
+			short ctgrow = max (ctgrowtmpstack, ctslots);
 			
-			*p = *vpush;
+			if (ctslots + ctgrow > 0x7fff) /*cttmpstack is a short*/
+				ctgrow = 0x7fff - ctslots;
 			
-			return (true);
+			// langerror (tmpstackoverflowerror); /*no room in tmpstack*/
+			
+			if (ctgrow <= 0 || !enlargehandle ((Handle) ht, ctgrow * sizeof (tyvaluerecord), nil)) /*zero-filled, so novaluetype*/
+				return (false);
+			
+			(**ht).cttmpstack += ctgrow;
 			}
-		} /*for*/
-	
-	// langerror (tmpstackoverflowerror); /*loop terminated, no room in tmpstack*/
-	
-	if (!enlargehandle ((Handle) currenthashtable, ctgrowtmpstack * sizeof (tyvaluerecord), nil))
-		return (false);
+		}
 	
 	(*vpush).fltmpstack = true;
 	
-	(**currenthashtable).tmpstack [(**currenthashtable).cttmpstack] = *vpush;
-	
-	(**currenthashtable).cttmpstack += ctgrowtmpstack;
+	(**ht).tmpstack [(**ht).cttmpinuse++] = *vpush;
 	
 	return (true);
 	} /*pushtmpstackvalue*/
@@ -169,18 +216,24 @@ static boolean removeheaptmp (Handle h) {
 	
 	register short ctloops;
 	register tyvaluerecord *p;
+	register hdlhashtable ht = currenthashtable;
 	
-	if (currenthashtable == nil)
+	if (ht == nil)
 		return (false);
 	
-	p = (**currenthashtable).tmpstack;
+	ctloops = (**ht).cttmpinuse;
 	
-	for (ctloops = (**currenthashtable).cttmpstack; ctloops--; ++p) { /*step through tmpstack*/
+	p = (**ht).tmpstack + ctloops;
+	
+	while (--ctloops >= 0) { /*step down through tmpstack, most recent first*/
 		
-		if ((*p).data.binaryvalue == h) { /*found the temp in the stack*/
+		if ((*--p).data.binaryvalue == h) { /*found the temp in the stack*/
 			
 			initvalue (p, novaluetype); /*nil the entry so it can be re-used*/
 			
+			if (ctloops == (**ht).cttmpinuse - 1) /*it was on top*/
+				poptmpstackholes (ht);
+			
 			return (true);
 			}
 		} /*while*/
@@ -7981,7 +7981,263 @@ static boolean binaryfunctionvalue (hdlhashnode hnode, bigstring bsname, hdltree
 	} /*binaryfunctionvalue*/
 
 
-boolean langfunctioncall (hdltreenode hcallernode, hdlhashtable htable, hdlhashnode hnode, bigstring bsname, hdltreenode hcode, hdltreenode hparam1, tyvaluerecord *vreturned) {
+#define cthandlerstatsbuckets 256
+
+#define cthandlerstatsmax 4096 /*stop adding records past this many handlers*/
+
+#define handlerstatsbucket(hnode) ((((unsigned long) (hnode)) >> 4) % cthandlerstatsbuckets)
+
+typedef struct tyhandlerstatsrecord {
+	
+	struct tyhandlerstatsrecord **hnext; /*next record in the same bucket*/
+	
+	hdlhashnode hnode; /*the handler's node; nil once the node has been disposed*/
+	
+	long ctactive; /*calls in progress; a disposed handler's record is freed when this gets to zero*/
+	
+	unsigned long ctcalls;
+	
+	UInt64 cttotalmicros; /*FastMicroseconds, so short handlers don't round to zero*/
+	
+	UInt64 ctmaxmicros;
+	
+	unsigned long ctbytes;
+	
+	bigstring bspath; /*quoted path of the handler, taken on its first call*/
+	} tyhandlerstatsrecord, *ptrhandlerstatsrecord, **hdlhandlerstatsrecord;
+
+static hdlhandlerstatsrecord handlerstatsbuckets [cthandlerstatsbuckets];
+
+static long cthandlerstats = 0;
+
+
+static hdlhandlerstatsrecord langfindhandlerstats (hdlhashtable htable, hdlhashnode hnode, bigstring bsname) {
+	
+	/*
+	find or create the stats record for the handler at hnode. the node's 
+	flhandlerstats bit tells us whether a record exists without walking 
+	the bucket for the common case of a first call.
+	*/
+	
+	hdlhandlerstatsrecord *hbucket = &handlerstatsbuckets [handlerstatsbucket (hnode)];
+	hdlhandlerstatsrecord hs;
+	bigstring bspath;
+	
+	if ((**hnode).flhandlerstats) {
+		
+		for (hs = *hbucket; hs != nil; hs = (**hs).hnext)
+			if ((**hs).hnode == hnode)
+				return (hs);
+		}
+	
+	if (cthandlerstats >= cthandlerstatsmax)
+		return (nil);
+	
+	if (!langexternalgetquotedpath (htable, bsname, bspath))
+		copystring (bsname, bspath);
+	
+	if (!newclearhandle (sizeof (tyhandlerstatsrecord), (Handle *) &hs))
+		return (nil);
+	
+	(**hs).hnode = hnode;
+	
+	copystring (bspath, (**hs).bspath);
+	
+	(**hs).hnext = *hbucket;
+	
+	*hbucket = hs;
+	
+	++cthandlerstats;
+	
+	(**hnode).flhandlerstats = true;
+	
+	return (hs);
+	} /*langfindhandlerstats*/
+
+
+static void langdisposehandlerstats (hdlhandlerstatsrecord hs, hdlhashnode hnode) {
+	
+	/*
+	unlink the record from the bucket of hnode, the node it was made for, 
+	and free it. hnode may already be disposed; only its address is used.
+	*/
+	
+	hdlhandlerstatsrecord *hprev;
+	
+	for (hprev = &handlerstatsbuckets [handlerstatsbucket (hnode)]; *hprev != nil; hprev = &(***hprev).hnext) {
+		
+		if (*hprev == hs) {
+			
+			*hprev = (**hs).hnext;
+			
+			disposehandle ((Handle) hs);
+			
+			--cthandlerstats;
+			
+			return;
+			}
+		}
+	} /*langdisposehandlerstats*/
+
+
+void langhandlerstatsdisposed (hdlhashnode hnode) {
+	
+	/*
+	called by disposehashnode for nodes with the flhandlerstats bit set. the 
+	handler is gone, so its record goes too, making room under cthandlerstatsmax. 
+	if the handler is still running, langfunctioncall frees the record when 
+	the last call returns.
+	*/
+	
+	hdlhandlerstatsrecord hs;
+	
+	for (hs = handlerstatsbuckets [handlerstatsbucket (hnode)]; hs != nil; hs = (**hs).hnext) {
+		
+		if ((**hs).hnode == hnode) {
+			
+			if ((**hs).ctactive > 0)
+				(**hs).hnode = nil;
+			else
+				langdisposehandlerstats (hs, hnode);
+			
+			return;
+			}
+		}
+	} /*langhandlerstatsdisposed*/
+
+
+static boolean langlookupmicrosvalue (hdlhashtable ht, bigstring bs, UInt64 *x) {
+	
+	/*
+	times are reported as doubles; a long runs out of microseconds in 35 minutes
+	*/
+	
+	tyvaluerecord val;
+	hdlhashnode hnode;
+	
+	if (!langhashtablelookup (ht, bs, &val, &hnode))
+		return (false);
+	
+	if (!copyvaluerecord (val, &val) || !coercetodouble (&val))
+		return (false);
+	
+	*x = (UInt64) **val.data.doublevalue;
+	
+	return (true);
+	} /*langlookupmicrosvalue*/
+
+
+static boolean langassignmicrosvalue (hdlhashtable ht, const bigstring bs, UInt64 x) {
+	
+	tyvaluerecord val;
+	
+	if (!setdoublevalue ((double) x, &val))
+		return (false);
+	
+	if (!hashtableassign (ht, bs, val))
+		return (false);
+	
+	exemptfromtmpstack (&val);
+	
+	return (true);
+	} /*langassignmicrosvalue*/
+
+
+static boolean langaddhandlerstats (hdlhashtable ht, hdlhandlerstatsrecord hs) {
+	
+	/*
+	add the record to a subtable of ht named by the handler's path. a 
+	disposed handler and its replacement share a path, so merge into 
+	an existing subtable rather than overwrite it.
+	*/
+	
+	tyhandlerstatsrecord stats = **hs;
+	hdlhashtable hsub;
+	tyvaluerecord val;
+	hdlhashnode hnode;
+	long x;
+	UInt64 micros;
+	
+	if (hashtablelookup (ht, stats.bspath, &val, &hnode) && langsuretablevalue (ht, stats.bspath, &hsub)) {
+		
+		if (langlookuplongvalue (hsub, BIGSTRING ("\x09" "callCount"), &x))
+			stats.ctcalls += x;
+		
+		if (langlookupmicrosvalue (hsub, BIGSTRING ("\x0b" "totalMicros"), &micros))
+			stats.cttotalmicros += micros;
+		
+		if (langlookupmicrosvalue (hsub, BIGSTRING ("\x09" "maxMicros"), &micros) && micros > stats.ctmaxmicros)
+			stats.ctmaxmicros = micros;
+		
+		if (langlookuplongvalue (hsub, BIGSTRING ("\x0a" "allocBytes"), &x))
+			stats.ctbytes += x;
+		}
+	else {
+		
+		if (!langsuretablevalue (ht, stats.bspath, &hsub))
+			return (false);
+		}
+	
+	if (!langassignlongvalue (hsub, BIGSTRING ("\x09" "callCount"), stats.ctcalls))
+		return (false);
+	
+	if (!langassignmicrosvalue (hsub, BIGSTRING ("\x0b" "totalMicros"), stats.cttotalmicros))
+		return (false);
+	
+	if (!langassignmicrosvalue (hsub, BIGSTRING ("\x09" "maxMicros"), stats.ctmaxmicros))
+		return (false);
+	
+	return (langassignlongvalue (hsub, BIGSTRING ("\x0a" "allocBytes"), stats.ctbytes));
+	} /*langaddhandlerstats*/
+
+
+boolean langgethandlerstats (hdlhashtable ht, boolean flreset) {
+	
+	/*
+	fill ht with one subtable per handler that has been called, holding its 
+	call count, total and maximum wall time in microseconds, and the bytes 
+	allocated while it ran. times and bytes include nested calls, and time 
+	spent swapped out while other threads ran.
+	
+	if flreset is true, zero the counters afterwards. records of disposed 
+	handlers are freed as they go, so those handlers aren't reported.
+	*/
+	
+	hdlhandlerstatsrecord hs;
+	short ix;
+	
+	for (ix = 0; ix < cthandlerstatsbuckets; ++ix) {
+		
+		for (hs = handlerstatsbuckets [ix]; hs != nil; hs = (**hs).hnext) {
+			
+			if ((**hs).ctcalls > 0)
+				if (!langaddhandlerstats (ht, hs))
+					return (false);
+			}
+		}
+	
+	if (!flreset)
+		return (true);
+	
+	for (ix = 0; ix < cthandlerstatsbuckets; ++ix) {
+		
+		for (hs = handlerstatsbuckets [ix]; hs != nil; hs = (**hs).hnext) {
+			
+			(**hs).ctcalls = 0;
+			
+			(**hs).cttotalmicros = 0;
+			
+			(**hs).ctmaxmicros = 0;
+			
+			(**hs).ctbytes = 0;
+			}
+		}
+	
+	return (true);
+	} /*langgethandlerstats*/
+
+
+static boolean langrunfunctioncall (hdltreenode hcallernode, hdlhashtable htable, hdlhashnode hnode, bigstring bsname, hdltreenode hcode, hdltreenode hparam1, tyvaluerecord *vreturned) {
 	
 	/*
 	run the code pointed to by hcode.  hparam1 points at the first parameter to
@@ -8081,6 +8337,14 @@ boolean langfunctioncall (hdltreenode hcallernode, hdlhashtable htable, hdlhashn
 			hname = (**hp2).param2; /*point at the name of the 1st param*/
 		}
 	
+	/*
+	a handler gets its frame even if it declares no parameters or locals. the 
+	frame is what hashgetstackdepth and the debugger's stack view count, and 
+	it carries "this". it comes off the free list, bucket array and all, so 
+	it costs no allocation after the first call. evaluatelist's pre-scan 
+	already skips the frame for nested blocks with no locals.
+	*/
+	
 	if (!newhashtable (&hlocaltable)) /*new table for the function when it runs*/
 		return (false);
 	
@@ -8130,6 +8394,55 @@ boolean langfunctioncall (hdltreenode hcallernode, hdlhashtable htable, hdlhashn
 		}
 	*/
 	
+	return (fl);
+	} /*langrunfunctioncall*/
+
+
+boolean langfunctioncall (hdltreenode hcallernode, hdlhashtable htable, hdlhashnode hnode, bigstring bsname, hdltreenode hcode, hdltreenode hparam1, tyvaluerecord *vreturned) {
+	
+	/*
+	run the handler, keeping its call count, wall time and allocation 
+	stats; see langgethandlerstats. handlers in local tables come and 
+	go with every call to their enclosing handler, so they aren't tracked.
+	*/
+	
+	hdlhandlerstatsrecord hs = nil;
+	UInt64 startmicros, micros;
+	unsigned long startbytes;
+	boolean fl;
+	
+	if (hnode != nil && htable != nil && !(**htable).fllocaltable)
+		hs = langfindhandlerstats (htable, hnode, bsname);
+	
+	if (hs == nil)
+		return (langrunfunctioncall (hcallernode, htable, hnode, bsname, hcode, hparam1, vreturned));
+	
+	++(**hs).ctactive;
+	
+	startbytes = ctbytesallocated;
+	
+	startmicros = FastMicroseconds ();
+	
+	fl = langrunfunctioncall (hcallernode, htable, hnode, bsname, hcode, hparam1, vreturned);
+	
+	micros = FastMicroseconds () - startmicros;
+	
+	if (--(**hs).ctactive == 0 && (**hs).hnode == nil) { /*the handler was disposed while it ran*/
+		
+		langdisposehandlerstats (hs, hnode);
+		
+		return (fl);
+		}
+	
+	++(**hs).ctcalls;
+	
+	(**hs).cttotalmicros += micros;
+	
+	if (micros > (**hs).ctmaxmicros)
+		(**hs).ctmaxmicros = micros;
+	
+	(**hs).ctbytes += ctbytesallocated - startbytes;
+	
 	return (fl);
 	} /*langfunctioncall*/
 
@@ -35,8 +35,13 @@
 #include "byteorder.h"	/* 2006-04-08 aradke: endianness conversion macros */
 
 
+unsigned long ctbytesallocated = 0; /*running total of bytes handed out, for handler stats*/
+
+
 static Handle getnewhandle (long ctbytes) {
 	
+	ctbytesallocated += ctbytes;
+	
 	return NewHandle (ctbytes);
 }
 
@@ -48,6 +53,11 @@ boolean newhandle (long ctbytes, Handle *h) {
 
 static boolean resizehandle (Handle hresize, long size) {
 	
+	long oldsize = GetHandleSize (hresize);
+	
+	if (size > oldsize) /*only growth counts as allocation*/
+		ctbytesallocated += size - oldsize;
+	
 	SetHandleSize (hresize, size);
 	return (MemError () == noErr);
 }
@@ -465,6 +475,155 @@ long searchhandleunicase (Handle hsearch, Handle hpattern, long ixstart, long ix
 	} /*searchhandleunicase*/
 
 
+unsigned long hashbytes (ptrvoid pdata, long ct) {
+	
+	/*
+	a quick, well-distributed hash of ct bytes (FNV-1a), for caches that key 
+	on text. not suitable for anything that has to resist collisions
+	*/
+	
+	register ptrbyte p = (ptrbyte) pdata;
+	register unsigned long hashval = 2166136261UL;
+	
+	while (--ct >= 0)
+		hashval = (hashval ^ *p++) * 16777619UL;
+	
+	return (hashval);
+	} /*hashbytes*/
+
+
+unsigned long hashhandle (Handle h) {
+	
+	if (h == nil)
+		return (hashbytes (nil, 0));
+	
+	return (hashbytes (*h, gethandlesize (h)));
+	} /*hashhandle*/
+
+
+#define handlecachebucket(cache, hashval) (&(*(cache)).buckets [(hashval) % cthandlecachebuckets])
+
+
+static void handlecacheunlink (tyhandlecache *cache, hdlhandlecacheitem h) {
+	
+	/*
+	take h out of the recently used list, leaving its bucket alone
+	*/
+	
+	register hdlhandlecacheitem hnext = (**h).hnext;
+	register hdlhandlecacheitem hprev = (**h).hprev;
+	
+	if (hprev == nil)
+		(*cache).hfirst = hnext;
+	else
+		(**hprev).hnext = hnext;
+	
+	if (hnext == nil)
+		(*cache).hlast = hprev;
+	else
+		(**hnext).hprev = hprev;
+	} /*handlecacheunlink*/
+
+
+static void handlecachelinkfirst (tyhandlecache *cache, hdlhandlecacheitem h) {
+	
+	(**h).hprev = nil;
+	
+	(**h).hnext = (*cache).hfirst;
+	
+	if ((*cache).hfirst == nil)
+		(*cache).hlast = h;
+	else
+		(**(*cache).hfirst).hprev = h;
+	
+	(*cache).hfirst = h;
+	} /*handlecachelinkfirst*/
+
+
+boolean handlecachelookup (tyhandlecache *cache, Handle hkey, unsigned long hashval, hdlhandlecacheitem *hitem) {
+	
+	/*
+	find the item whose key matches the contents of hkey, and make it the 
+	most recently used. hashval must be hashhandle (hkey); only items in 
+	its bucket are compared.
+	*/
+	
+	register hdlhandlecacheitem h;
+	
+	for (h = *handlecachebucket (cache, hashval); h != nil; h = (**h).hnextinbucket) {
+		
+		if ((**h).hashval == hashval && equalhandles ((**h).hkey, hkey)) {
+			
+			if (h != (*cache).hfirst) {
+				
+				handlecacheunlink (cache, h);
+				
+				handlecachelinkfirst (cache, h);
+				}
+			
+			*hitem = h;
+			
+			return (true);
+			}
+		}
+	
+	return (false);
+	} /*handlecachelookup*/
+
+
+void handlecacheinsert (tyhandlecache *cache, hdlhandlecacheitem hitem) {
+	
+	/*
+	add hitem, whose hashval and hkey are already set, as the most recently 
+	used item. the caller should then handlecachetrim the cache.
+	*/
+	
+	hdlhandlecacheitem *hbucket = handlecachebucket (cache, (**hitem).hashval);
+	
+	(**hitem).hnextinbucket = *hbucket;
+	
+	*hbucket = hitem;
+	
+	handlecachelinkfirst (cache, hitem);
+	
+	++(*cache).ctitems;
+	} /*handlecacheinsert*/
+
+
+boolean handlecachetrim (tyhandlecache *cache, hdlhandlecacheitem *hitem) {
+	
+	/*
+	if the cache holds more than its maximum, unlink its least recently used 
+	item and return it so the caller can dispose of it. call repeatedly 
+	until we return false.
+	*/
+	
+	register hdlhandlecacheitem h = (*cache).hlast;
+	hdlhandlecacheitem *hprev;
+	
+	if ((*cache).ctitems <= (*cache).ctmax || h == nil)
+		return (false);
+	
+	handlecacheunlink (cache, h);
+	
+	for (hprev = handlecachebucket (cache, (**h).hashval); *hprev != nil; hprev = &(***hprev).hnextinbucket) {
+		
+		if (*hprev == h) {
+			
+			*hprev = (**h).hnextinbucket;
+			
+			break;
+			}
+		}
+	
+	--(*cache).ctitems;
+	
+	*hitem = h;
+	
+	return (true);
+	} /*handlecachetrim*/
+
+
 boolean sethandlecontents (ptrvoid pdata, long ctset, Handle hset) {
 	
 	if (!sethandlesize (hset, ctset))
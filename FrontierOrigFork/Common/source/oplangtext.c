@@ -50,6 +50,8 @@ static boolean flmakeitpretty;
 
 static Handle *plastcomment;
 
+static Handle hlangtextbreaks; /*if non-nil, receives the offset of each top-level statement*/
+
 
 
 
@@ -148,6 +150,11 @@ static boolean oplangtextvisit (hdlheadrecord hnode, ptrvoid refcon) {
 	
 	6.0a13 dmb: rewrote to use handles, handlestreams
 	
+	if hlangtextbreaks is set, record where each new top-level statement 
+	starts -- just past the semicolon that separates it from the one before. 
+	"else" lines and continuations don't get a semicolon, so they stay with 
+	the statement they belong to.
+	
 	2006-01-23 smd: lots of changes when flmakepretty is true,
 	to fix problems with round trip between script outline and text.
 	This function is in desperate need of a rewrite, but it seem to work now
@@ -168,6 +175,7 @@ static boolean oplangtextvisit (hdlheadrecord hnode, ptrvoid refcon) {
 	byte ch;
 	long len1, len2;
 	boolean fl = false;
+	boolean flnewstatement = false;
 	
 	level = (**h).headlevel;
 	
@@ -267,8 +275,12 @@ static boolean oplangtextvisit (hdlheadrecord hnode, ptrvoid refcon) {
 
 				if (!equalidentifiers (bsfirst, BIGSTRING (STR_else))) { /*never want a semicolon before else*/
 					
-					if (!flmakeitpretty || !flcomment || !remainingsubheadsarecomments (h))  /* no semicolon before the closing braces */
+					if (!flmakeitpretty || !flcomment || !remainingsubheadsarecomments (h)) { /* no semicolon before the closing braces */
+						
 						pushchar (';', bs);
+						
+						flnewstatement = (level == 0);
+						}
 					}
 				}
 			}
@@ -276,6 +288,14 @@ static boolean oplangtextvisit (hdlheadrecord hnode, ptrvoid refcon) {
 		if (!writehandlestreamstring (langtext, bs))
 			goto exit;
 		
+		if (flnewstatement && (hlangtextbreaks != nil)) {
+			
+			long ix = (*langtext).pos;
+			
+			if (!enlargehandle (hlangtextbreaks, sizeof (ix), &ix))
+				goto exit;
+			}
+		
 		langtextlastlevel = level;
 		}
 	
@@ -463,4 +483,34 @@ boolean opgetlangtext (hdloutlinerecord houtline, boolean flpretty, Handle *htex
 	} /*opgetlangtext*/
 
 
+boolean opgetlangtextbreaks (hdloutlinerecord houtline, Handle *htext, Handle *hbreaks) {
+	
+	/*
+	get the compilable text of a script outline, plus an array of longs giving 
+	the offset in htext just past each semicolon that separates two top-level 
+	statements. each run of text between breaks can be compiled on its own.
+	*/
+	
+	boolean fl;
+	
+	if (!newemptyhandle (hbreaks))
+		return (false);
+	
+	hlangtextbreaks = *hbreaks;
+	
+	fl = opgetlangtext (houtline, false, htext);
+	
+	hlangtextbreaks = nil;
+	
+	if (!fl) {
+		
+		disposehandle (*hbreaks);
+		
+		*hbreaks = nil;
+		}
+	
+	return (fl);
+	} /*opgetlangtextbreaks*/
+
+
 
@@ -46,6 +46,13 @@ implemented in op.c.  this is such a thing.
 the idea is that any list built on top of op, could someday easily be
 displayed in a window, and be interacted with by the user.  both noble
 goals.  so here goes!
+
+lists are no longer kept in an outline while in memory. walking headlines 
+made list [i] O(i) and record lookups a string compare per item, so items 
+now live in a growable array, and records with more than a few items get 
+a name index built on demand. the outline is still the packed format: 
+oppacklist builds one on the fly and opunpacklist takes one apart, so 
+stored lists are unchanged.
 */
 
 
@@ -53,16 +60,36 @@ goals.  so here goes!
 
 #define oplistversionnumber 1
 
+#define ctminitemsallocated 4 /*smallest item array we allocate*/
+
+#define ctminindexeditems 8 /*records with fewer items are searched linearly*/
+
+
+typedef struct tylistitem {
+	
+	Handle hdata; /*the caller's data*/
+	
+	hdlstring hname; /*nil if the item is unnamed*/
+	
+	unsigned long hashval; /*hash of the name, for quick comparisons*/
+	} tylistitem, *ptrlistitem, **hdllistitems;
+
 
 typedef struct tylistrecord {
 	
-	struct tyoutlinerecord ** houtline; /*the list is stored in an outline*/
+	hdllistitems hitems; /*the items, in order; nil until the first push*/
+	
+	long ctallocated; /*number of item slots in hitems*/
 	
-	long ctitems; /*number of items in the list, can be gotten without traversal*/
+	long ctitems; /*number of items in the list*/
 
 	boolean isrecord; /*do items have names?*/
 	
 	oplistreleaseitemcallback releaseitemcallback; /*routine that releases one of **your** handles*/
+	
+	long **hindex; /*open hash of 1-based item indexes by name, 0 for empty slots; nil if not built*/
+	
+	long ctindexslots; /*always a power of 2*/
 	} tylistrecord;
 
 
@@ -86,73 +113,250 @@ typedef struct tydisklistrecord {
 	} tydisklistrecord;
 
 
-static hdllistrecord hcurrentlist = nil;
+static unsigned long oplisthashname (ptrstring pname) {
+	
+	return (hashbytes (stringbaseaddress (pname), stringlength (pname)));
+	} /*oplisthashname*/
 
 
-/*static boolean oplistreleaserefcon (hdlheadrecord hnode, boolean fl) {
+static boolean oplistitemnamed (ptrlistitem pitem, ptrstring pname, unsigned long hashval) {
 	
-	cb = (**hcurrentlist).releaseitemcallback;
+	bigstring bs;
 	
-	if (cb)
-		return ((*cb) ((**hnode).hrefcon));
-	} /%oplistreleaserefcon%/
-*/
+	if ((*pitem).hashval != hashval)
+		return (false);
+	
+	copyheapstring ((*pitem).hname, bs); /*checks for nil*/
+	
+	return (equalstrings (bs, pname));
+	} /*oplistitemnamed*/
 
 
-boolean opnewlist (hdllistrecord *hlist, boolean isrecord) {
+static void oplistdisposeindex (hdllistrecord hlist) {
 	
 	/*
-	7.31.97 dmb: expanded implementation to serve as UserTalk's list
-	and record datatype.
+	called whenever items move; the index is rebuilt the next time it's needed
+	*/
+	
+	disposehandle ((Handle) (**hlist).hindex);
+	
+	(**hlist).hindex = nil;
+	
+	(**hlist).ctindexslots = 0;
+	} /*oplistdisposeindex*/
+
+
+static boolean oplistindexitem (hdllistrecord hlist, long ix) {
+	
+	/*
+	add the item at 0-based ix to the name index. when names repeat, the 
+	first one wins, just like a linear search.
+	
+	return false if the index is too full to take another item.
 	*/
+	
+	register hdllistrecord h = hlist;
+	register long mask = (**h).ctindexslots - 1;
+	register long slot;
+	ptrlistitem pitems = *(**h).hitems;
+	unsigned long hashval = pitems [ix].hashval;
+	bigstring bs;
+	
+	if (2 * ((**h).ctitems + 1) > (**h).ctindexslots)
+		return (false);
+	
+	copyheapstring (pitems [ix].hname, bs);
+	
+	for (slot = hashval & mask; (*(**h).hindex) [slot] != 0; slot = (slot + 1) & mask) {
+		
+		if (oplistitemnamed (&pitems [(*(**h).hindex) [slot] - 1], bs, hashval))
+			return (true); /*already have one by this name*/
+		}
+	
+	(*(**h).hindex) [slot] = ix + 1;
+	
+	return (true);
+	} /*oplistindexitem*/
 
-	register hdllistrecord h;
-	hdloutlinerecord houtline;
+
+static boolean oplistbuildindex (hdllistrecord hlist) {
 	
-	if (!newclearhandle (sizeof (tylistrecord), (Handle *) hlist))
+	register hdllistrecord h = hlist;
+	register long ctslots = 16;
+	register long ix;
+	Handle hindex;
+	
+	while (ctslots < 2 * ((**h).ctitems + 1))
+		ctslots <<= 1;
+	
+	if (!newclearhandle (ctslots * sizeof (long), &hindex))
 		return (false);
 	
-	h = *hlist; /*copy into register*/
+	(**h).hindex = (long **) hindex;
+	
+	(**h).ctindexslots = ctslots;
+	
+	for (ix = 0; ix < (**h).ctitems; ++ix)
+		oplistindexitem (h, ix);
+	
+	return (true);
+	} /*oplistbuildindex*/
+
 
-	if (!newoutlinerecord (&houtline)) { 
+static boolean opgetlistitem (hdllistrecord hlist, long ix, ptrstring pname, long *ixitem) {
+	
+	/*
+	should be an internal routine -- this guy returns the 0-based index 
+	into our item array for the indicated 1-based index, or for the named 
+	item if ix is -1.
+	*/
+	
+	register hdllistrecord h = hlist;
+	register long i;
+	unsigned long hashval;
+	
+	if (h == nil) /*defensive driving*/
+		return (false);
+	
+	if (ix == -1 && pname != nil) { /*looking up by name*/
 		
-		disposehandle ((Handle) h);
+		if (!(**h).isrecord)
+			return (false);
+		
+		hashval = oplisthashname (pname);
+		
+		if ((**h).ctitems >= ctminindexeditems) {
+			
+			if ((**h).hindex != nil || oplistbuildindex (h)) {
+				
+				register long mask = (**h).ctindexslots - 1;
+				long slot;
+				
+				for (slot = hashval & mask; (i = (*(**h).hindex) [slot]) != 0; slot = (slot + 1) & mask) {
+					
+					if (oplistitemnamed (&(*(**h).hitems) [i - 1], pname, hashval)) {
+						
+						*ixitem = i - 1;
+						
+						return (true);
+						}
+					}
+				
+				return (false);
+				}
+			}
+		
+		for (i = 0; i < (**h).ctitems; ++i) { /*short record, or no memory for an index*/
+			
+			if (oplistitemnamed (&(*(**h).hitems) [i], pname, hashval)) {
+				
+				*ixitem = i;
+				
+				return (true);
+				}
+			}
 		
 		return (false);
 		}
+	else {
+		if ((ix < 1) || (ix > (**h).ctitems))
+			return (false);
 		
-	(**houtline).flbuildundo = false;
+		*ixitem = ix - 1;
+		
+		return (true);
+		}
+	} /*opgetlistitem*/
+
+
+static boolean oplistmakeroom (hdllistrecord hlist) {
 	
-	(**houtline).flinhibitdisplay = true;
+	/*
+	make sure there's a free slot at the end of the item array, doubling 
+	its size when it's full so that building a list is linear
+	*/
+	
+	register hdllistrecord h = hlist;
+	register long ctallocated = (**h).ctallocated;
+	Handle hitems;
+	
+	if ((**h).ctitems < ctallocated)
+		return (true);
+	
+	ctallocated = max (ctminitemsallocated, 2 * ctallocated);
+	
+	if ((**h).hitems == nil) {
+		
+		if (!newhandle (ctallocated * sizeof (tylistitem), &hitems))
+			return (false);
+		
+		(**h).hitems = (hdllistitems) hitems;
+		}
+	else {
+		
+		if (!sethandlesize ((Handle) (**h).hitems, ctallocated * sizeof (tylistitem)))
+			return (false);
+		}
+	
+	(**h).ctallocated = ctallocated;
+	
+	return (true);
+	} /*oplistmakeroom*/
+
 
-	(**h).houtline = houtline;
+static boolean oplistnewitem (ptrstring pname, Handle hdata, tylistitem *item) {
+	
+	clearbytes (item, sizeof (tylistitem));
 	
-	(**h).ctitems = 0;
+	(*item).hdata = hdata;
 	
-	(**h).isrecord = isrecord;
+	if (pname != nil && stringlength (pname) > 0) {
+		
+		if (!newheapstring (pname, &(*item).hname))
+			return (false);
+		
+		(*item).hashval = oplisthashname (pname);
+		}
+	else
+		(*item).hashval = oplisthashname (emptystring);
+	
+	return (true);
+	} /*oplistnewitem*/
+
+
+boolean opnewlist (hdllistrecord *hlist, boolean isrecord) {
 	
 	/*
-	(**houtline).releaserefconcallback = &oplistreleaserefcon;
+	7.31.97 dmb: expanded implementation to serve as UserTalk's list
+	and record datatype.
 	*/
 
+	if (!newclearhandle (sizeof (tylistrecord), (Handle *) hlist))
+		return (false);
+	
+	(***hlist).isrecord = isrecord;
+	
 	return (true);
 	} /*opnewlist*/
 	
 	
 void opdisposelist (hdllistrecord hlist) {
 	
-	register hdloutlinerecord ho;
+	register long ix;
 	
 	if (hlist == nil) /*defensive driving*/
 		return;
+	
+	for (ix = 0; ix < (**hlist).ctitems; ++ix) {
 		
-	hcurrentlist = hlist; /*for our callback routines*/
+		disposehandle ((*(**hlist).hitems) [ix].hdata);
+		
+		disposehandle ((Handle) (*(**hlist).hitems) [ix].hname);
+		}
 	
-	ho = (hdloutlinerecord) (**hlist).houtline;
+	disposehandle ((Handle) (**hlist).hitems);
 	
-	opdisposeoutline (ho, false);
-	
-	hcurrentlist = nil;
+	disposehandle ((Handle) (**hlist).hindex);
 	
 	disposehandle ((Handle) hlist);
 	} /*opdisposelist*/
@@ -161,75 +365,32 @@ void opdisposelist (hdllistrecord hlist) {
 boolean oppushhandle (hdllistrecord hlist, ptrstring pname, Handle hdata) {
 	
 	/*
-	add a new item at the end of the list.  link in the indicated handle in the
-	refcon field of the allocated headrecord.  return false if there's an allocation
-	error.
+	add a new item at the end of the list, linking in the indicated handle. 
+	return false if there's an allocation error.
 
 	8.11.97 dmb: dispose hdata on error.
 	*/
 	
 	register hdllistrecord h = hlist;
-	register hdlheadrecord hlast;
-	register hdloutlinerecord ho;
-	register long ctitems;
-	hdlheadrecord hnew;
-	bigstring bs;
+	tylistitem item;
+	long ix;
 	
 	if ((**h).isrecord && (pname == nil))
 		goto error;
-
-	ho = (hdloutlinerecord) (**h).houtline;
 	
-	if (!oppushoutline (ho))
+	if (!oplistmakeroom (h))
 		goto error;
 	
-	ctitems = (**h).ctitems;
-	
-	copystring (pname, bs); /*checks for nil*/
-	
-	if (ctitems == 0) { /*adding to an empty list*/
-		
-		hnew = (**ho).hsummit; /*set this guy's refcon handle*/
-		
-		opsetheadstring (hnew, bs);
-		}
-		
-	else {
-		hlast = oprepeatedbump (down, ctitems - 1, (**ho).hsummit, false);
-		
-	//	setstringlength (bs, 0);
-
-		if (!opaddheadline (hlast, down, bs, &hnew)) {
-
-			oppopoutline ();
-
-			goto error;
-			}
-		
-		(**ho).ctexpanded++;
-		
-		(**hnew).flexpanded = true;
-		}
+	if (!oplistnewitem (pname, hdata, &item))
+		goto error;
 	
-	#ifdef fldebug
+	ix = (**h).ctitems++;
 	
-	if (fldebugging) {
-		
-		copystring ((ptrstring) "\x0A" "headline #", bs);
-		
-		pushint (ctitems + 1, bs);
-		
-		opsetheadstring (hnew, bs);
-		}
-	
-	#endif
+	(*(**h).hitems) [ix] = item;
 	
-	(**hnew).hrefcon = hdata; /*link in the user's data structure*/
+	if ((**h).hindex != nil && !oplistindexitem (h, ix))
+		oplistdisposeindex (h); /*too full; rebuild bigger when next needed*/
 	
-	(**h).ctitems++;
-
-	oppopoutline ();
-
 	return (true);
 
 	error:
@@ -243,71 +404,30 @@ boolean oppushhandle (hdllistrecord hlist, ptrstring pname, Handle hdata) {
 boolean opunshifthandle (hdllistrecord hlist, ptrstring pname, Handle hdata) {
 	
 	/*
-	add a new item at the beginning of the list.  link in the indicated handle in the
-	refcon field of the allocated headrecord.  return false if there's an allocation
-	error.
+	add a new item at the beginning of the list, linking in the indicated handle.
+	return false if there's an allocation error.
 	*/
 	
 	register hdllistrecord h = hlist;
-	register hdlheadrecord hstart;
-	register hdloutlinerecord ho;
-	register long ctitems;
-	hdlheadrecord hnew;
-	bigstring bs;
+	tylistitem item;
 	
 	if ((**h).isrecord && (pname == nil))
 		goto error;
-
-	ho = (hdloutlinerecord) (**h).houtline;
 	
-	if (!oppushoutline (ho))
+	if (!oplistmakeroom (h))
 		goto error;
 	
-	ctitems = (**h).ctitems;
-	
-	copystring (pname, bs); /*checks for nil*/
-	
-	if (ctitems == 0) { /*adding to an empty list*/
-		
-		hnew = (**ho).hsummit; /*set this guy's refcon handle*/
-		
-		opsetheadstring (hnew, bs);
-		}
-		
-	else {
-		hstart = (**ho).hsummit;
-
-		if (!opaddheadline (hstart, up, bs, &hnew)) {
-
-			oppopoutline ();
-
-			goto error;
-			}
-		
-		(**ho).ctexpanded++;
-		
-		(**hnew).flexpanded = true;
-		}
+	if (!oplistnewitem (pname, hdata, &item))
+		goto error;
 	
-	#ifdef fldebug
+	moveright (*(**h).hitems, *(**h).hitems + 1, (**h).ctitems * sizeof (tylistitem));
 	
-	if (fldebugging) {
-		
-		copystring ((ptrstring) "\x0A" "headline #", bs);
-		
-		pushint (ctitems + 1, bs);
-		
-		opsetheadstring (hnew, bs);
-		}
+	(*(**h).hitems) [0] = item;
 	
-	#endif
+	(**h).ctitems++;
 	
-	(**hnew).hrefcon = hdata; /*link in the user's data structure*/
+	oplistdisposeindex (h);
 	
-	(**h).ctitems++;
-
-	oppopoutline ();
-
 	return (true);
 
 	error:
@@ -346,77 +466,27 @@ boolean oppushstring (hdllistrecord hlist, ptrstring pname, bigstring bs) {
 	} /*oppushstring*/
 	
 
-static boolean opgetlistnode (hdllistrecord hlist, long ix, ptrstring pname, hdlheadrecord *hnode) {
-	
-	/*
-	should be an internal routine -- this guy returns the outline headrecord for
-	the indicated index into the list.
-	*/
-	
-	hdloutlinerecord ho;
-	hdlheadrecord nomad;
-	bigstring bshead;
-	
-	*hnode = nil;
-	
-	if (hlist == nil) /*defensive driving*/
-		return (false);
-	
-	ho = (hdloutlinerecord) (**hlist).houtline;
-
-	if (ix == -1 && pname != nil) { /*looking up by name*/
-		
-		if (!(**hlist).isrecord)
-			return (false);
-		
-		for (nomad = (**ho).hsummit; ; ) {
-			
-			opgetheadstring (nomad, bshead);
-			
-			if (equalstrings (bshead, pname)) {
-				
-				*hnode = nomad;
-
-				return (true);
-				}
-
-			if (!opchasedown (&nomad))
-				return (false);
-			}
-		}
-	else {
-		if ((ix < 1) || (ix > (**hlist).ctitems))
-			return (false);
-		
-		*hnode = oprepeatedbump (down, ix - 1, (**ho).hsummit, false);
-		
-		return (true);
-		}
-	} /*opgetlistnode*/
-
-
 boolean opgetlisthandle (hdllistrecord hlist, long ix, ptrstring pname, Handle *hdata) {
 	
 	/*
-	the user's data is stored in the refcon handle in each headrecord.
+	the user's data is stored in a handle linked into each item.
 	
-	we index through the list, to the ixth item, and return the refcon
-	handle for that list item.
+	we return the data handle for the ixth item, or the named item.
 	
 	ix is 1-based.  the first item is item #1 and so on.
 	
 	return false if there aren't ix items in the list.
 	*/
 	
-	hdlheadrecord hnode;
+	long ixitem;
 	
-	if (!opgetlistnode (hlist, ix, pname, &hnode))
+	if (!opgetlistitem (hlist, ix, pname, &ixitem))
 		return (false);
 	
 	if (pname != nil)
-		opgetheadstring (hnode, pname);
+		copyheapstring ((*(**hlist).hitems) [ixitem].hname, pname);
 	
-	*hdata = (**hnode).hrefcon;
+	*hdata = (*(**hlist).hitems) [ixitem].hdata;
 	
 	return (true);
 	} /*opgetlisthandle*/
@@ -441,11 +511,10 @@ boolean opgetliststring (hdllistrecord hlist, long ix, ptrstring pname, bigstrin
 
 boolean opsetlisthandle (hdllistrecord hlist, long ix, ptrstring pname, Handle hdata) {
 	
-	hdlheadrecord hnode;
-	hdloutlinerecord ho = (hdloutlinerecord) (**hlist).houtline;
+	long ixitem;
 	boolean flpush;
 	
-	if (!opgetlistnode (hlist, ix, pname, &hnode)) {
+	if (!opgetlistitem (hlist, ix, pname, &ixitem)) {
 		
 		if (ix == -1 && pname != nil) //looking up by name*/
 			flpush = (**hlist).isrecord;
@@ -461,11 +530,9 @@ boolean opsetlisthandle (hdllistrecord hlist, long ix, ptrstring pname, Handle h
 		return (false);
 		}
 	
-	(*(**ho).releaserefconcallback) (hnode, true);
-	
-	disposehandle ((**hnode).hrefcon); /*get rid of the old handle*/
+	disposehandle ((*(**hlist).hitems) [ixitem].hdata); /*get rid of the old handle*/
 	
-	(**hnode).hrefcon = hdata; /*link in the new one*/
+	(*(**hlist).hitems) [ixitem].hdata = hdata; /*link in the new one*/
 	
 	return (true);
 	} /*opsetlistdata*/
@@ -522,58 +589,148 @@ oplistreleaseitemcallback opsetreleaseitemcallback (hdllistrecord hlist, oplistr
 	} /*opsetreleaseitemcallback*/
 
 
-static boolean opdeletelistnode (hdloutlinerecord ho, hdlheadrecord hdelete) {
+boolean opdeletelistitem (hdllistrecord hlist, long ix, ptrstring pname) {
 	
-	hdlheadrecord hother;
+	register hdllistrecord h = hlist;
+	long ixitem;
 	
-	hother = hdelete;
-
-	if (!opchasedown (&hother) && !opchaseup (&hother)) // deleting only summit (flat outline)
+	if (!opgetlistitem (h, ix, pname, &ixitem))
 		return (false);
 	
-	else {
-		if ((**ho).hsummit == hdelete)
-			(**ho).hsummit = hother;
-		
-		if ((**ho).hline1 == hdelete)
-			(**ho).hline1 = hother;
-		
-		if ((**ho).hbarcursor == hdelete)
-			(**ho).hbarcursor = hother;
-		
-		opunlink (hdelete);
+	disposehandle ((*(**h).hitems) [ixitem].hdata);
+	
+	disposehandle ((Handle) (*(**h).hitems) [ixitem].hname);
+	
+	(**h).ctitems--;
+	
+	moveleft (*(**h).hitems + ixitem + 1, *(**h).hitems + ixitem, ((**h).ctitems - ixitem) * sizeof (tylistitem));
+	
+	oplistdisposeindex (h);
+	
+	return (true);
+	} /*opdeletelistitem*/
 
-		(**ho).ctexpanded--;
+
+static void oplistunlinkoutline (hdloutlinerecord ho) {
+	
+	/*
+	the data handles in a packing outline are borrowed from a list, or 
+	have been adopted by one. unlink them so opdisposeoutline leaves them be.
+	*/
+	
+	hdlheadrecord nomad = (**ho).hsummit;
+	
+	while (true) {
+		
+		(**nomad).hrefcon = nil;
 		
-		if ((**hdelete).flmarked)
-			(**ho).ctmarked --;
+		if (!opchasedown (&nomad))
+			break;
 		}
-	
-	return (true);
-	} /*opdeletelistnode*/
+	} /*oplistunlinkoutline*/
 
 
-boolean opdeletelistitem (hdllistrecord hlist, long ix, ptrstring pname) {
+static boolean oplisttooutline (hdllistrecord hlist, hdloutlinerecord *houtline) {
 	
-	hdlheadrecord hnode;
-	hdloutlinerecord ho = (hdloutlinerecord) (**hlist).houtline;
+	/*
+	build the outline that's our packed format: one summit per item, with 
+	its name as the headline and its data handle -- borrowed, not copied -- 
+	in the refcon.
+	*/
+	
+	register hdllistrecord h = hlist;
+	register long ix;
+	hdloutlinerecord ho;
+	hdlheadrecord hlast, hnew;
+	bigstring bs;
 	
-	if (!opgetlistnode (hlist, ix, pname, &hnode))
+	if (!newoutlinerecord (&ho))
 		return (false);
 	
-	oppushoutline (ho);
+	(**ho).flbuildundo = false;
 	
-	if (opdeletelistnode (ho, hnode))
-		opreleasenode (hnode, false);
-	else
-		opemptyrefcon (hnode);
+	(**ho).flinhibitdisplay = true;
+	
+	if (!oppushoutline (ho)) {
+		
+		opdisposeoutline (ho, false);
+		
+		return (false);
+		}
+	
+	hlast = (**ho).hsummit;
+	
+	for (ix = 0; ix < (**h).ctitems; ++ix) {
+		
+		copyheapstring ((*(**h).hitems) [ix].hname, bs);
+		
+		if (ix == 0) {
+			
+			hnew = hlast;
+			
+			opsetheadstring (hnew, bs);
+			}
+		else {
+			
+			if (!opaddheadline (hlast, down, bs, &hnew)) {
+				
+				oppopoutline ();
+				
+				oplistunlinkoutline (ho);
+				
+				opdisposeoutline (ho, false);
+				
+				return (false);
+				}
+			
+			(**ho).ctexpanded++;
+			
+			(**hnew).flexpanded = true;
+			}
+		
+		(**hnew).hrefcon = (*(**h).hitems) [ix].hdata;
+		
+		hlast = hnew;
+		}
 	
 	oppopoutline ();
 	
-	(**hlist).ctitems--;
+	*houtline = ho;
 	
 	return (true);
-	} /*opdeletelistitem*/
+	} /*oplisttooutline*/
+
+
+static boolean oplistfromoutline (hdllistrecord hlist, hdloutlinerecord ho, long ctitems) {
+	
+	/*
+	adopt the first ctitems summits of the unpacked outline ho as our items; 
+	-1 means all of them.
+	*/
+	
+	hdlheadrecord nomad = (**ho).hsummit;
+	register long ix;
+	bigstring bs;
+	
+	for (ix = 0; ctitems < 0 || ix < ctitems; ++ix) {
+		
+		opgetheadstring (nomad, bs);
+		
+		if (!oppushhandle (hlist, bs, (**nomad).hrefcon)) {
+			
+			(**nomad).hrefcon = nil; /*disposed by oppushhandle*/
+			
+			return (false);
+			}
+		
+		(**nomad).hrefcon = nil; /*it's ours now*/
+		
+		if (!opchasedown (&nomad))
+			break;
+		}
+	
+	return (true);
+	} /*oplistfromoutline*/
 
 
 boolean oppacklist (hdllistrecord hlist, Handle *hpacked) {
@@ -583,18 +740,28 @@ boolean oppacklist (hdllistrecord hlist, Handle *hpacked) {
 	*/
 	
 	tydisklistrecord info;
+	hdloutlinerecord ho;
 	Handle hpackedoutline = nil;
 	Handle hpackedlist = nil;
 	boolean fl;
 	
-	if (!oppushoutline ((hdloutlinerecord) (**hlist).houtline))
+	if (!oplisttooutline (hlist, &ho))
 		return (false);
+	
+	if (!oppushoutline (ho))
+		fl = false;
+	
+	else {
+		hpackedoutline = nil; /*allocate a new handle for packing*/
+		
+		fl = oppack (&hpackedoutline);
 		
-	hpackedoutline = nil; /*allocate a new handle for packing*/
+		oppopoutline ();
+		}
 	
-	fl = oppack (&hpackedoutline);
+	oplistunlinkoutline (ho);
 	
-	oppopoutline ();
+	opdisposeoutline (ho, false);
 	
 	if (!fl)
 		return (false);
@@ -632,8 +799,6 @@ boolean oppacklist (hdllistrecord hlist, Handle *hpacked) {
 		
 	error:
 	
-	oppopoutline ();
-	
 	disposehandle (hpackedoutline);
 	
 	disposehandle (hpackedlist);
@@ -730,32 +895,26 @@ boolean opunpacklist (Handle hpacked, hdllistrecord *hnewlist) {
 		hpacked = nil;
 	#endif
 	
-	// (**hlist).ctitems = makelong (info.ctitems, info.ctitems_hiword);
-	(**hlist).ctitems = info.ctitems;
+	fl = opunpackoutline (hpackedoutline, &ho);
 	
-	(**hlist).isrecord = info.isrecord;
+	disposehandle (hpackedoutline);
 	
-	ho = (hdloutlinerecord) (**hlist).houtline;
+	hpackedoutline = nil; /*so it won't get disposed in case of an error*/
 	
-	opdisposeoutline (ho, false); /*opunpack will create a new one*/
+	if (!fl)
+		goto error;
 	
-	(**hlist).houtline = nil; /*don't leave it dangling*/
+	// (**hlist).ctitems = makelong (info.ctitems, info.ctitems_hiword);
 	
-	fl = opunpackoutline (hpackedoutline, &ho);
+	if (info.ctitems != 0) /*an empty list still packs one empty summit*/
+		fl = oplistfromoutline (hlist, ho, info.ctitems); // -1 if we couldn't store it; > 32K
 	
-	disposehandle (hpackedoutline);
-	
-	hpackedoutline = nil; /*so it won't get disposed in case of an error*/
+	opdisposeoutline (ho, false); /*adopted items were unlinked; anything left over goes with it*/
 	
 	if (!fl)
 		goto error;
-		
-	(**hlist).houtline = ho;
-		
-	if (info.ctitems == -1) { // couldn't store it; > 32K
-		
-		(**hlist).ctitems = opcountatlevel ((**ho).hsummit);
-		}
+	
+	(**hlist).isrecord = info.isrecord; /*after loading, so unnamed items aren't refused*/
 	
 	return (true);
 	
@@ -777,21 +936,60 @@ boolean opcopylist (hdllistrecord hsource, hdllistrecord *hcopy) {
 	5.0.2b12 dmb: new routine, so we don't have to pack/unpack
 	*/
 	
-	hdloutlinerecord ho;
+	register hdllistrecord h;
+	register long ix;
+	Handle hitems, hdata;
+	hdlstring hname;
 	
 	if (!copyhandle ((Handle) hsource, (Handle *) hcopy))
 		return (false);
 	
-	if (!opcopyoutlinerecord ((**hsource).houtline, &ho)) {
+	h = *hcopy; /*copy into register*/
+	
+	(**h).hindex = nil; /*rebuilt if needed*/
+	
+	(**h).ctindexslots = 0;
+	
+	if ((**h).hitems == nil)
+		return (true);
+	
+	if (!copyhandle ((Handle) (**hsource).hitems, &hitems)) {
 		
-		disposehandle ((Handle) *hcopy);
+		disposehandle ((Handle) h);
 		
 		return (false);
 		}
 	
-	(***hcopy).houtline = ho;
+	(**h).hitems = (hdllistitems) hitems;
+	
+	for (ix = 0; ix < (**h).ctitems; ++ix) { /*items still point at the source's handles*/
+		
+		if (!copyhandle ((*(**h).hitems) [ix].hdata, &hdata))
+			goto error;
+		
+		(*(**h).hitems) [ix].hdata = hdata;
+		
+		if (!copyhandle ((Handle) (*(**h).hitems) [ix].hname, (Handle *) &hname)) {
+			
+			(*(**h).hitems) [ix].hname = nil;
+			
+			++ix; /*hdata is ours*/
+			
+			goto error;
+			}
+		
+		(*(**h).hitems) [ix].hname = hname;
+		}
 	
 	return (true);
+	
+	error:
+	
+		(**h).ctitems = ix; /*dispose only the copies we've made*/
+		
+		opdisposelist (h);
+		
+		return (false);
 	} /*opcopylist*/
 
 
@@ -834,35 +1032,19 @@ boolean opvisitlist (hdllistrecord hlist, opvisitlistcallback visit, ptrvoid ref
 	The callback should return false to break out of the loop.
 	*/
 	
-	hdloutlinerecord ho;
-	register hdlheadrecord nomad, nextnomad;
+	register long ix;
+	tylistitem item;
 	bigstring bskey;
 
-	/*
-	2005-03-30 smd: if the list is empty, we're done.
-	*/
-	if (opcountlistitems (hlist) == 0)
-		return (true);
-	
-	ho = (hdloutlinerecord) (**hlist).houtline;
-	
-	nomad = (**ho).hsummit;
-	
-	while (true) {
+	for (ix = 0; ix < (**hlist).ctitems; ++ix) {
 		
-		nextnomad = (**nomad).headlinkdown;
+		item = (*(**hlist).hitems) [ix];
 		
-		opgetheadstring (nomad, bskey);
+		copyheapstring (item.hname, bskey);
 		
-		if (!(*visit) ((**nomad).hrefcon, bskey, refcon))
+		if (!(*visit) (item.hdata, bskey, refcon))
 			return (false);
-			
-		if (nextnomad == nomad) 
-			break;
-			
-		nomad = nextnomad;
-		} /*while*/
+		} /*for*/
 
 	return (true);
 	} /*opvisitlist*/
-
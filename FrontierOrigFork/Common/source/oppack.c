@@ -131,7 +131,9 @@ typedef struct tyversion2diskheader {
 	
 	short horizcurrent_hiword; //horiz min, max aren't really used
 	
-	short waste [3]; /*room to grow*/
+	short codecache, codecache_hiword; /*dbaddress of the script's compiled code cache, see scripts.c*/
+	
+	short waste [1]; /*room to grow*/
 	} tyversion2diskheader;
 
 
@@ -556,6 +558,9 @@ boolean oppack (Handle *hpackedoutline) {
 	
 	header.outlinesignature = conditionallongswap((**ho).outlinesignature);
 	
+	if (!fldatabasesaveas) /*the cache block doesn't exist in the new file*/
+		memlongtodiskwords ((**ho).adrcodecache, header.codecache, header.codecache_hiword);
+	
 	hsummit = (**ho).hsummit; /*copy into register*/
 	
 	opwriteeditbuffer (); /*if a headline is being edited, update text handle*/
@@ -1014,6 +1019,8 @@ static boolean opunpackversion2 (handlestream *packstream) {
 
 	(**ho).outlinesignature = conditionallongswap (header.outlinesignature);
 	
+	(**ho).adrcodecache = diskwordstomemlong (header.codecache, header.codecache_hiword);
+	
 	ixstart = (*packstream).pos;
 	
 	pushscratchport ();
@@ -1150,6 +1157,65 @@ boolean opunpackoutline (Handle hpackedoutline, hdloutlinerecord *houtline) {
 	} /*opunpackoutline*/
 
 
+static boolean opgetpackedheader (Handle hpackedoutline, tyversion2diskheader **pheader) {
+	
+	/*
+	point at the header of a packed outline, as stored in the database.
+	we only deal with the current format family.
+	*/
+	
+	short versionnumber;
+	
+	if (gethandlesize (hpackedoutline) < (long) sizeof (tyversion2diskheader))
+		return (false);
+	
+	*pheader = (tyversion2diskheader *) *hpackedoutline;
+	
+	versionnumber = conditionalshortswap ((**pheader).versionnumber);
+	
+	return ((versionnumber >= 2) && (hibyte (versionnumber) == hibyte (opversionnumber)));
+	} /*opgetpackedheader*/
+
+
+boolean opgetpackedcodecache (Handle hpackedoutline, dbaddress *adr) {
+	
+	/*
+	return the address of the compiled code cache recorded in a packed 
+	outline, without unpacking the whole thing.
+	*/
+	
+	tyversion2diskheader *pheader;
+	
+	*adr = nildbaddress;
+	
+	if (!opgetpackedheader (hpackedoutline, &pheader))
+		return (false);
+	
+	*adr = diskwordstomemlong ((*pheader).codecache, (*pheader).codecache_hiword);
+	
+	return (true);
+	} /*opgetpackedcodecache*/
+
+
+boolean opsetpackedcodecache (Handle hpackedoutline, dbaddress adr) {
+	
+	/*
+	update the compiled code cache address in a packed outline in place. 
+	the size of the handle doesn't change, so the database block that 
+	holds it can be rewritten without moving.
+	*/
+	
+	tyversion2diskheader *pheader;
+	
+	if (!opgetpackedheader (hpackedoutline, &pheader))
+		return (false);
+	
+	memlongtodiskwords (adr, (*pheader).codecache, (*pheader).codecache_hiword);
+	
+	return (true);
+	} /*opsetpackedcodecache*/
+
+
 boolean optextscraptooutline (hdloutlinerecord houtline, Handle htext, hdlheadrecord *hnode) {
 #pragma unused (houtline)
 
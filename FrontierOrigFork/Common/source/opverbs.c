@@ -223,6 +223,12 @@ typedef enum tyoptoken { /*verbs that are processed by op.c*/
 	
 	stopprofilefunc,
 	
+	startsamplingfunc,
+	
+	stopsamplingfunc,
+	
+	getsamplesfunc,
+	
 	getosacodefunc,
 	
 	getosasourcefunc,
@@ -242,6 +248,8 @@ typedef enum tyoptoken { /*verbs that are processed by op.c*/
 		
 		unsigned short flscript: 1; /*outlines and scripts are identical, except for this bit*/
 		
+		unsigned short flcodecachepending: 1; /*linked code to be cached at the next save, see opverbsavecodecache*/
+		
 		long variabledata; /*either a hdloutlinerecord or a dbaddress*/
 		
 		hdldatabaserecord hdatabase; // 5.0a18 dmb
@@ -317,6 +325,8 @@ static boolean opverbdisposecode (hdloutlinevariable hvariable) {
 		(**hv).linkedcode = nil;
 		}
 	
+	(**hv).flcodecachepending = false; /*no point caching code that's been thrown away*/
+	
 	return (true);
 	} /*opverbdisposecode*/
 
@@ -331,12 +341,44 @@ static boolean opdisposevariable (hdlexternalvariable hvariable, boolean fldisk)
 	} /*opdisposevariable*/
 
 
+static void opverbreleasecodecache (hdloutlinevariable hv) {
+	
+	/*
+	the script is being deleted; release the db block holding its 
+	compiled code cache, if any. if the outline isn't in memory we 
+	have to consult its packed header on disk.
+	*/
+	
+	dbaddress adr = nildbaddress;
+	Handle hpacked;
+	
+	dbpushdatabase ((**hv).hdatabase);
+	
+	if ((**hv).flinmemory)
+		adr = (**(hdloutlinerecord) (**hv).variabledata).adrcodecache;
+	
+	else if (dbrefhandle ((dbaddress) (**hv).variabledata, &hpacked)) {
+		
+		opgetpackedcodecache (hpacked, &adr);
+		
+		disposehandle (hpacked);
+		}
+	
+	dbpushreleasestack (adr, scriptvaluetype);
+	
+	dbpopdatabase ();
+	} /*opverbreleasecodecache*/
+
+
 boolean opverbdispose (hdlexternalvariable hvariable, boolean fldisk) {
 	
 	register hdlexternalvariable hv = hvariable;
 	
 	opverbdisposecode ((hdloutlinevariable) hv); /*must check for code even if outline isn't in memory*/
 	
+	if (fldisk && (**(hdloutlinevariable) hv).flscript)
+		opverbreleasecodecache ((hdloutlinevariable) hv);
+	
 	return (langexternaldisposevariable (hv, fldisk, &opdisposevariable));
 	} /*opverbdispose*/
 
@@ -674,6 +716,8 @@ boolean opverbmemoryunpack (Handle hpacked, long *ixload, hdlexternalvariable *h
 	
 	opverbsetupoutline (ho, *h);
 	
+	(**ho).adrcodecache = nildbaddress; /*the code cache belongs to the original*/
+	
 	(**ho).fldirty = true; /*never been saved, can't be clean*/
 	
 	return (true);
@@ -713,6 +757,95 @@ boolean opverbscriptmemoryunpack (Handle hpacked, long *ixload, hdlexternalvaria
 	} /*opverbscriptmemoryunpack*/
 
 
+static boolean opverbcopyscriptblock (dbaddress adrorig, dbaddress *adrcopy) {
+	
+	/*
+	like dbcopy, for saving a copy of a script that isn't in memory. the 
+	compiled code cache isn't copied, so clear the reference to it.
+	*/
+	
+	Handle hpacked;
+	boolean fl;
+	
+	if (!dbrefhandle (adrorig, &hpacked))
+		return (false);
+	
+	opsetpackedcodecache (hpacked, nildbaddress);
+	
+	fl = dballochandle (hpacked, adrcopy);
+	
+	disposehandle (hpacked);
+	
+	return (fl);
+	} /*opverbcopyscriptblock*/
+
+
+static boolean opverbsavecodecache (hdloutlinevariable hv) {
+	
+	/*
+	called from opverbpack as a script is saved. if it's been compiled since 
+	it was last saved, have scripts.c pack its code into a cache block, store 
+	that in the database and point the outline at it, releasing the previous 
+	cache block. the outline is brought into memory if need be; return true 
+	if it must be repacked to record the new address, and opverbpack will 
+	unload it again. failure isn't an error; the code just gets compiled 
+	again next time, and an outline we loaded is released here.
+	*/
+	
+	register hdloutlinerecord ho;
+	hdltreenode hcode = (hdltreenode) (**hv).linkedcode;
+	Handle htext, hcache;
+	dbaddress adrnew;
+	boolean fltempload;
+	boolean fl;
+	
+	if (!(**hv).flcodecachepending)
+		return (false);
+	
+	(**hv).flcodecachepending = false;
+	
+	if (hcode == nil)
+		return (false);
+	
+	fltempload = !(**hv).flinmemory;
+	
+	if (!opverbinmemory (hv))
+		return (false);
+	
+	ho = (hdloutlinerecord) (**hv).variabledata;
+	
+	fl = !(**ho).flrecentlychanged && opgetlangtext (ho, false, &htext); /*not if it's been edited since it was compiled*/
+	
+	if (fl) {
+		
+		fl = scriptpackcodecache (htext, (**ho).outlinesignature, hcode, &hcache);
+		
+		disposehandle (htext);
+		}
+	
+	if (fl) {
+		
+		fl = dballochandle (hcache, &adrnew);
+		
+		disposehandle (hcache);
+		}
+	
+	if (!fl) {
+		
+		if (fltempload)
+			opverbunload ((hdlexternalvariable) hv, (**hv).oldaddress);
+		
+		return (false);
+		}
+	
+	dbpushreleasestack ((**ho).adrcodecache, scriptvaluetype);
+	
+	(**ho).adrcodecache = adrnew;
+	
+	return (true);
+	} /*opverbsavecodecache*/
+
+
 boolean opverbpack (hdlexternalvariable h, Handle *hpacked, boolean *flnewdbaddress) {
 
 	/*
@@ -726,14 +859,28 @@ boolean opverbpack (hdlexternalvariable h, Handle *hpacked, boolean *flnewdbaddr
 	dbaddress adr;
 	hdlwindowinfo hinfo;
 	boolean fltempload = false;
+	boolean flnewcodecache = false;
+	
+	if (!fldatabasesaveas) /*a copy doesn't get the code cache*/
+		flnewcodecache = opverbsavecodecache (hv);
 	
 	if (!(**hv).flinmemory) { /*simple case, outline is resident in the db*/
 		
 			adr = (dbaddress) (**hv).variabledata;
 			
-			if (fldatabasesaveas)
-				if (!dbcopy (adr, &adr))
-					return (false);
+			if (fldatabasesaveas) {
+				
+				if ((**hv).flscript) {
+					
+					if (!opverbcopyscriptblock (adr, &adr))
+						return (false);
+					}
+				else {
+					
+					if (!dbcopy (adr, &adr))
+						return (false);
+					}
+				}
 			
 			goto pushaddress;
 			}
@@ -744,7 +891,7 @@ boolean opverbpack (hdlexternalvariable h, Handle *hpacked, boolean *flnewdbaddr
 	
 	adr = (**hv).oldaddress; /*place where this outline used to be stored*/
 	
-	if (!fldatabasesaveas && !(**ho).fldirty && !(**ho).fldirtyview) /*don't need to update the db version of the outline*/
+	if (!fldatabasesaveas && !(**ho).fldirty && !(**ho).fldirtyview && !flnewcodecache) /*don't need to update the db version of the outline*/
 		goto pushaddress;
 	
 	if (!opverbpackoutline (ho, &hpackedoutline))
@@ -853,6 +1000,87 @@ boolean opverbgetlangtext (hdlexternalvariable hvariable, boolean flpretty, Hand
 	} /*opverbgetlangtext*/
 
 
+boolean opverbgetscripttext (hdlexternalvariable hvariable, Handle *htext, Handle *hbreaks, long *signature, dbaddress *adrcodecache) {
+	
+	/*
+	like opverbgetlangtext, for the compiler. also return the address of the 
+	compiled code cache recorded with the outline, so the caller can try to 
+	avoid compiling the text at all, and the top-level statement breaks in 
+	the text, so it can compile them one at a time.
+	*/
+	
+	register hdloutlinevariable hv = (hdloutlinevariable) hvariable;
+	register hdloutlinerecord ho;
+	register boolean fltempload;
+	boolean fl;
+	
+	fltempload = !(**hv).flinmemory;
+	
+	if (!opverbinmemory (hv))
+		return (false);
+	
+	ho = (hdloutlinerecord) (**hv).variabledata;
+	
+	*signature = (**ho).outlinesignature;
+	
+	*adrcodecache = (**ho).adrcodecache;
+	
+	fl = opgetlangtextbreaks (ho, htext, hbreaks);
+	
+	if (fltempload)
+		opverbunload ((hdlexternalvariable) hv, (**hv).oldaddress);
+	
+	return (fl);
+	} /*opverbgetscripttext*/
+
+
+boolean opverbrefcodecache (hdlexternalvariable hvariable, dbaddress adr, Handle *hcache) {
+	
+	/*
+	read the compiled code cache block at adr from the variable's database
+	*/
+	
+	boolean fl;
+	
+	*hcache = nil;
+	
+	if (adr == nildbaddress)
+		return (false);
+	
+	dbpushdatabase ((**hvariable).hdatabase);
+	
+	fl = dbrefhandle (adr, hcache);
+	
+	dbpopdatabase ();
+	
+	return (fl);
+	} /*opverbrefcodecache*/
+
+
+void opverbsetcodecachepending (hdlexternalvariable hvariable) {
+	
+	/*
+	the script's code was just compiled from its text. nothing is written to 
+	the database now; opverbpack has the code packed into the cache the next 
+	time the script is saved along with its table. until then the script 
+	counts as a dirty sub of its table, so the save reaches it even if 
+	nothing was edited; see opverbcodecachepending.
+	*/
+	
+	(**(hdloutlinevariable) hvariable).flcodecachepending = true;
+	} /*opverbsetcodecachepending*/
+
+
+boolean opverbcodecachepending (hdlexternalvariable hvariable) {
+	
+	/*
+	is there compiled code waiting to be written to the cache at the next save?
+	*/
+	
+	return ((**(hdloutlinevariable) hvariable).flcodecachepending);
+	} /*opverbcodecachepending*/
+
+
 boolean opverbgetsize (hdlexternalvariable hvariable, long *size) {
 	
 	register hdloutlinevariable hv = (hdloutlinevariable) hvariable;
@@ -2145,6 +2373,67 @@ static boolean opstopprofileverb (hdltreenode hp1, tyvaluerecord *v) {
 } /*opstopprofileverb*/
 
 
+static boolean opstartsamplingverb (hdltreenode hp1, tyvaluerecord *v) {
+	
+	/*
+	turn on the sampling profiler for all threads. unlike startprofile, this 
+	isn't tied to the calling process, and costs almost nothing per call.
+	
+	samples are only taken at the scheduler's checks, of the thread running. 
+	time spent inside a kernel verb is charged to the frame that's on top when 
+	the verb returns; see processtakesample.
+	*/
+	
+	short ctconsumed = 0;
+	short ctpositional = 0;
+	tyvaluerecord vinterval;
+	
+	setlongvalue (10, &vinterval);
+	
+	flnextparamislast = true;
+	
+	if (!getoptionalparamvalue (hp1, &ctconsumed, &ctpositional, BIGSTRING ("\x0a" "msInterval"), &vinterval))
+		return (false);
+	
+	if (!coercetolong (&vinterval))
+		return (false);
+	
+	if (vinterval.data.longvalue < 0)
+		vinterval.data.longvalue = 0;
+	
+	return (setbooleanvalue (processstartsampling (vinterval.data.longvalue), v));
+	} /*opstartsamplingverb*/
+
+
+static boolean opgetsamplesverb (hdltreenode hp1, tyvaluerecord *v) {
+	
+	/*
+	return the samples collected so far as a string in folded-stack format, 
+	which flame graph tools read directly. pass flReset true to start over.
+	*/
+	
+	short ctconsumed = 0;
+	short ctpositional = 0;
+	tyvaluerecord vflreset;
+	Handle htext;
+	
+	setbooleanvalue (false, &vflreset);
+	
+	flnextparamislast = true;
+	
+	if (!getoptionalparamvalue (hp1, &ctconsumed, &ctpositional, BIGSTRING ("\x07" "flReset"), &vflreset))
+		return (false);
+	
+	if (!coercetoboolean (&vflreset))
+		return (false);
+	
+	if (!processgetsamples (vflreset.data.flvalue, &htext))
+		return (false);
+	
+	return (setheapvalue (htext, stringvaluetype, v));
+	} /*opgetsamplesverb*/
+
+
 static boolean opverbrejectmenubar (bigstring bserror) {
 	
 	if ((**shellwindowinfo).configresnum == idmenueditorconfig) {
@@ -3190,6 +3479,9 @@ static boolean opfunctionvalue (short token, hdltreenode hparam1, tyvaluerecord
 			case getosasourcefunc:
 			case startprofilefunc:
 			case stopprofilefunc:
+			case startsamplingfunc:
+			case stopsamplingfunc:
+			case getsamplesfunc:
 				return (false);
 			
 			default:
@@ -3287,6 +3579,24 @@ static boolean opfunctionvalue (short token, hdltreenode hparam1, tyvaluerecord
 			
 			return (true);
 		
+		case startsamplingfunc:
+			if (!opstartsamplingverb (hparam1, v))
+				goto error;
+			
+			return (true);
+		
+		case stopsamplingfunc:
+			if (!langcheckparamcount (hparam1, 0))
+				goto error;
+			
+			return (setbooleanvalue (processstopsampling (), v));
+		
+		case getsamplesfunc:
+			if (!opgetsamplesverb (hparam1, v))
+				goto error;
+			
+			return (true);
+		
 		case visitallfunc: { /*7.0b17 PBS: visit all nodes in an outline*/
 			
 			if (!opvisitallverb (hparam1, v, bserror))
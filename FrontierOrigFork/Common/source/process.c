@@ -143,6 +143,10 @@ static long processonehottimeslice = 6;
 
 static long processagenttimeslice = 4;
 
+static long maxoneshotthreads = 0; /*cap on one-shot threads the scheduler starts; 0 means no limit*/
+
+static long ctoneshotthreads = 0; /*one-shot threads alive now*/
+
 
 boolean setagentsenable (boolean flagents) {
 	
@@ -254,6 +258,10 @@ void disposeprocess (hdlprocessrecord hprocess) {
 	protection should avoid deletion of a running process
 	
 	5.0.2b15 dmb: profiling
+	
+	a one-shot's code may be shared by many processes (flsharedcode), and its 
+	context table may have been built just for it (fldisposecontext). shared 
+	code with a reference count goes when its last holder lets go of it.
 	*/
 	
 	register hdlprocessrecord hp = hprocess;
@@ -261,8 +269,17 @@ void disposeprocess (hdlprocessrecord hprocess) {
 	
 	assert (!(**hp).flrunning);
 	
-	if ((**hp).floneshot)
-		langdisposetree ((**hp).hcode);
+	if ((**hp).floneshot) {
+		
+		if (!(**hp).flsharedcode)
+			langdisposetree ((**hp).hcode);
+		
+		else if ((**hp).hcoderefs != nil)
+			processreleasecode ((**hp).hcode, (**hp).hcoderefs);
+		}
+	
+	if ((**hp).fldisposecontext && ((**hp).hcontext != nil))
+		disposehashtable ((**hp).hcontext, false);
 	
 	langdisposetree ((**hp).holdcode);
 	
@@ -488,6 +505,23 @@ boolean processfindcode (hdltreenode hcode, hdlprocessrecord *hprocess) {
 	} /*processfindcode*/
 
 
+void processreleasecode (hdltreenode hcode, long **hrefs) {
+	
+	/*
+	drop one reference to code shared by several processes and its owner, 
+	counted in hrefs. whoever drops the last one disposes of the code and 
+	the count.
+	*/
+	
+	if (--**hrefs > 0)
+		return;
+	
+	langdisposetree (hcode);
+	
+	disposehandle ((Handle) hrefs);
+	} /*processreleasecode*/
+
+
 static boolean flvisitingthreads = false; // *** debug
 
 static boolean visitprocessthreads (pascal boolean (*visit) (hdlthreadglobals, long), long refcon) {
@@ -669,6 +703,8 @@ boolean processreplacecode (hdltreenode holdcode, hdltreenode hnewcode) {
 			
 			(**x).sleepuntil = 0; /*wake agent up if sleeping*/
 			
+			(**processlist).nextagenttime = 0;
+			
 			flreplaced = true;
 			
 			/*
@@ -783,6 +819,9 @@ boolean processagentsleep (long ctseconds) {
 	
 	(**hp).sleepuntil = x;
 	
+	if ((**hp).hprocesslist != nil && x < (**(**hp).hprocesslist).nextagenttime)
+		(**(**hp).hprocesslist).nextagenttime = x;
+	
 	/*
 	(**hp).flsleepinbackground = fldontbackground;
 	*/
@@ -810,24 +849,6 @@ boolean processisoneshot (boolean flnilok) {
 	} /*processisoneshot*/
 
 
-static boolean processbackgroundtask (boolean flresting) {
-	
-	/*
-	return true if background tasks should be given a shot while 
-	interpreting a script.
-	
-	7/4/91 dmb: don't background while langerror is disabled.  (otherwise, 
-	would need to save in thread state)
-	*/
-	
-	if (langerrorenabled ())
-		if (flagentsenabled || processisoneshot (false))
-			return (scriptbackgroundtask (flresting));
-	
-	return (true);
-	} /*processbackgroundtask*/
-
-
 boolean debuggingcurrentprocess (void) {
 	
 	register hdlprocessrecord hp = currentprocess;
@@ -908,6 +929,324 @@ boolean profilingcurrentprocess (void) {
 	} /*profilingcurrentprocess*/
 
 
+/*
+sampling profiler. while it's on, every samplinginterval milliseconds we look at 
+the error stack of the thread that's running -- the same frames gettracebacklist 
+reports -- and count how often each distinct stack was seen. threads are 
+cooperative, so the one that's running is the one using the processor. the 
+check rides on the background task callback, which the scheduler gets at the 
+end of every block a script runs, so there's no cost but a flag test when 
+sampling is off, and no timer interrupting code that isn't prepared for it. 
+stacks are kept in folded form, outermost script first, ready for flame graph 
+tools.
+
+the samples are biased, and it's worth knowing how. we only look at the stack 
+at those scheduler points, and only at the running thread's; threads that are 
+waiting aren't sampled. a sample that comes due while a kernel verb runs -- a 
+long file read, a tcp call that doesn't yield -- is taken at the next check, 
+so the time is charged to whatever frame is on top then, usually the one that 
+made the call. each sample is weighted by the number of intervals that went 
+by since the last one, so a long verb still counts for its full time.
+*/
+
+#define ctsamplebuckets 256
+
+#define maxsamplestacks 4096 /*distinct stacks we'll remember; more are counted as dropped*/
+
+typedef struct tysamplerecord {
+	
+	struct tysamplerecord **hnext; /*next stack in the same bucket*/
+	
+	unsigned long hashval;
+	
+	long ctsamples;
+	
+	Handle hstack; /*folded text: "outer;inner;innermost"*/
+	} tysamplerecord, *ptrsamplerecord, **hdlsamplerecord;
+
+
+static hdlsamplerecord samplebuckets [ctsamplebuckets];
+
+static boolean flsampling = false;
+
+static unsigned long samplinginterval = 10; /*milliseconds*/
+
+static unsigned long nextsampletime = 0;
+
+static long ctsamplestacks = 0;
+
+static long ctsamplesdropped = 0;
+
+
+static boolean processfoldstack (hdlerrorstack hs, Handle *hstack) {
+	
+	/*
+	build the folded form of the error stack hs, outermost frame first. 
+	semicolons separate frames, so we don't let one appear in a path.
+	*/
+	
+	register short ix;
+	register short ct = (**hs).toperror;
+	tyerrorrecord *pe;
+	hdlhashtable htable;
+	bigstring bsname, bspath;
+	langerrorcallback errorcallback;
+	long errorrefcon;
+	
+	if (!newemptyhandle (hstack))
+		return (false);
+	
+	for (ix = 0; ix < ct; ++ix) {
+		
+		pe = &(**hs).stack [ix];
+		
+		errorcallback = (*pe).errorcallback;
+		
+		errorrefcon = (*pe).errorrefcon;
+		
+		if (errorcallback == nil ||
+			!(*errorcallback) (errorrefcon, 0, 0, &htable, bsname) ||
+			!langexternalgetquotedpath (htable, bsname, bspath)) {
+			
+			langgetstringlist (anomynousthreadstring, bspath);
+			}
+		
+		stringreplaceall (';', ',', bspath);
+		
+		if (ix > 0)
+			insertchar (';', bspath);
+		
+		if (!pushtexthandle (bspath, *hstack)) {
+			
+			disposehandle (*hstack);
+			
+			return (false);
+			}
+		}
+	
+	return (true);
+	} /*processfoldstack*/
+
+
+static void processaddsample (Handle hstack, long ctsamples) {
+	
+	/*
+	count ctsamples sightings of hstack, which we consume
+	*/
+	
+	unsigned long hashval = hashhandle (hstack);
+	hdlsamplerecord *pbucket;
+	hdlsamplerecord hs;
+	
+	pbucket = &samplebuckets [hashval % ctsamplebuckets];
+	
+	for (hs = *pbucket; hs != nil; hs = (**hs).hnext) {
+		
+		if ((**hs).hashval == hashval && equalhandles ((**hs).hstack, hstack)) {
+			
+			(**hs).ctsamples += ctsamples;
+			
+			disposehandle (hstack);
+			
+			return;
+			}
+		}
+	
+	if ((ctsamplestacks >= maxsamplestacks) || !newclearhandle (sizeof (tysamplerecord), (Handle *) &hs)) {
+		
+		++ctsamplesdropped;
+		
+		disposehandle (hstack);
+		
+		return;
+		}
+	
+	(**hs).hashval = hashval;
+	
+	(**hs).ctsamples = ctsamples;
+	
+	(**hs).hstack = hstack;
+	
+	(**hs).hnext = *pbucket;
+	
+	*pbucket = hs;
+	
+	++ctsamplestacks;
+	} /*processaddsample*/
+
+
+static void processtakesample (void) {
+	
+	/*
+	if it's time, record the stack of the current thread. its frames' names 
+	are resolved through its own error callbacks, which is only safe while 
+	its globals are swapped in.
+	
+	compare the difference of the times, so the millisecond clock wrapping 
+	doesn't stop the sampling. if we're late, the sample counts for all the 
+	intervals we missed.
+	*/
+	
+	register hdlprocessrecord hp = currentprocess;
+	unsigned long msnow = getmilliseconds ();
+	long ctsamples;
+	Handle hstack;
+	
+	if ((long) (msnow - nextsampletime) < 0)
+		return;
+	
+	ctsamples = 1 + (msnow - nextsampletime) / samplinginterval;
+	
+	nextsampletime = msnow + samplinginterval;
+	
+	if ((hp == nil) || ((**hp).herrorstack == nil) || ((**(**hp).herrorstack).toperror == 0))
+		return;
+	
+	if (processfoldstack ((**hp).herrorstack, &hstack))
+		processaddsample (hstack, ctsamples);
+	} /*processtakesample*/
+
+
+static boolean processbackgroundtask (boolean flresting) {
+	
+	/*
+	return true if background tasks should be given a shot while 
+	interpreting a script.
+	
+	7/4/91 dmb: don't background while langerror is disabled.  (otherwise, 
+	would need to save in thread state)
+	
+	this is also where the sampling profiler gets a chance to run.
+	*/
+	
+	if (flsampling && !flresting)
+		processtakesample ();
+	
+	if (langerrorenabled ())
+		if (flagentsenabled || processisoneshot (false))
+			return (scriptbackgroundtask (flresting));
+	
+	return (true);
+	} /*processbackgroundtask*/
+
+
+static void processclearsamples (void) {
+	
+	register short i;
+	register hdlsamplerecord hs, hnext;
+	
+	for (i = 0; i < ctsamplebuckets; ++i) {
+		
+		for (hs = samplebuckets [i]; hs != nil; hs = hnext) {
+			
+			hnext = (**hs).hnext;
+			
+			disposehandle ((**hs).hstack);
+			
+			disposehandle ((Handle) hs);
+			}
+		
+		samplebuckets [i] = nil;
+		}
+	
+	ctsamplestacks = 0;
+	
+	ctsamplesdropped = 0;
+	} /*processclearsamples*/
+
+
+boolean processstartsampling (unsigned long msinterval) {
+	
+	/*
+	start (or resume) sampling every msinterval milliseconds. samples already 
+	collected are kept until processgetsamples is asked to reset them.
+	*/
+	
+	if (msinterval == 0)
+		msinterval = 10;
+	
+	samplinginterval = msinterval;
+	
+	nextsampletime = getmilliseconds () + msinterval;
+	
+	flsampling = true;
+	
+	return (true);
+	} /*processstartsampling*/
+
+
+boolean processstopsampling (void) {
+	
+	if (!flsampling)
+		return (false);
+	
+	flsampling = false;
+	
+	return (true);
+	} /*processstopsampling*/
+
+
+boolean processgetsamples (boolean flreset, Handle *htext) {
+	
+	/*
+	return the samples in folded-stack format, one line per distinct stack: 
+	the frames separated by semicolons, a space, and the number of samples. 
+	stacks we had no room for are reported on a last line as "[dropped]".
+	*/
+	
+	register short i;
+	hdlsamplerecord hs;
+	handlestream s;
+	bigstring bs;
+	
+	openhandlestream (nil, &s);
+	
+	for (i = 0; i < ctsamplebuckets; ++i) {
+		
+		for (hs = samplebuckets [i]; hs != nil; hs = (**hs).hnext) {
+			
+			numbertostring ((**hs).ctsamples, bs);
+			
+			insertchar (chspace, bs);
+			
+			pushchar (chlinefeed, bs);
+			
+			if (!writehandlestreamhandle (&s, (**hs).hstack) || !writehandlestreamstring (&s, bs))
+				goto error;
+			}
+		}
+	
+	if (ctsamplesdropped > 0) {
+		
+		copystring (BIGSTRING ("\x0a" "[dropped] "), bs);
+		
+		pushlong (ctsamplesdropped, bs);
+		
+		pushchar (chlinefeed, bs);
+		
+		if (!writehandlestreamstring (&s, bs))
+			goto error;
+		}
+	
+	*htext = closehandlestream (&s);
+	
+	if (*htext == nil && !newemptyhandle (htext))
+		return (false);
+	
+	if (flreset)
+		processclearsamples ();
+	
+	return (true);
+	
+	error:
+	
+	disposehandlestream (&s);
+	
+	return (false);
+	} /*processgetsamples*/
+
+
+
 static boolean processdebugger (hdltreenode hnode) {
 	
 	/*
@@ -1025,6 +1364,125 @@ boolean infrontierthread (void) {
 	} /*infrontierthread*/
 
 
+static hdlthreadglobals **htimeoutheap = nil; /*min-heap of threads sleeping with a timeout*/
+
+static long cttimeoutheap = 0;
+
+#define timeoutbefore(hg1, hg2) ((long) ((**(hg1)).timetowake - (**(hg2)).timetowake) < 0)
+
+
+static void timeoutheapset (long ix, hdlthreadglobals hg) {
+	
+	(*htimeoutheap) [ix - 1] = hg;
+	
+	(**hg).ixtimeoutheap = ix;
+	} /*timeoutheapset*/
+
+
+static void timeoutheapsiftup (long ix) {
+	
+	hdlthreadglobals hg = (*htimeoutheap) [ix - 1];
+	hdlthreadglobals hparent;
+	
+	while (ix > 1) {
+		
+		hparent = (*htimeoutheap) [ix / 2 - 1];
+		
+		if (!timeoutbefore (hg, hparent))
+			break;
+		
+		timeoutheapset (ix, hparent);
+		
+		ix /= 2;
+		}
+	
+	timeoutheapset (ix, hg);
+	} /*timeoutheapsiftup*/
+
+
+static void timeoutheapsiftdown (long ix) {
+	
+	hdlthreadglobals hg = (*htimeoutheap) [ix - 1];
+	hdlthreadglobals hchild;
+	long ixchild;
+	
+	while ((ixchild = ix * 2) <= cttimeoutheap) {
+		
+		if (ixchild < cttimeoutheap && timeoutbefore ((*htimeoutheap) [ixchild], (*htimeoutheap) [ixchild - 1]))
+			++ixchild; /*right child is sooner*/
+		
+		hchild = (*htimeoutheap) [ixchild - 1];
+		
+		if (!timeoutbefore (hchild, hg))
+			break;
+		
+		timeoutheapset (ix, hchild);
+		
+		ix = ixchild;
+		}
+	
+	timeoutheapset (ix, hg);
+	} /*timeoutheapsiftdown*/
+
+
+static boolean timeoutheapinsert (hdlthreadglobals hg) {
+	
+	/*
+	add a sleeping thread to the heap, keyed by its timetowake. keys are 
+	compared by their signed difference, so a tick count that wraps 
+	around while threads are asleep doesn't upset the order.
+	*/
+	
+	long ctslots = (htimeoutheap == nil)? 0 : gethandlesize ((Handle) htimeoutheap) / sizeof (hdlthreadglobals);
+	
+	if (cttimeoutheap >= ctslots) {
+		
+		ctslots = max (ctslots * 2, 32);
+		
+		if (htimeoutheap == nil) {
+			
+			if (!newhandle (ctslots * sizeof (hdlthreadglobals), (Handle *) &htimeoutheap))
+				return (false);
+			}
+		else {
+			
+			if (!sethandlesize ((Handle) htimeoutheap, ctslots * sizeof (hdlthreadglobals)))
+				return (false);
+			}
+		}
+	
+	(*htimeoutheap) [cttimeoutheap++] = hg;
+	
+	timeoutheapsiftup (cttimeoutheap);
+	
+	return (true);
+	} /*timeoutheapinsert*/
+
+
+static void timeoutheapremove (hdlthreadglobals hg) {
+	
+	long ix = (**hg).ixtimeoutheap;
+	hdlthreadglobals hlast;
+	
+	if (ix == 0) /*not in the heap*/
+		return;
+	
+	(**hg).ixtimeoutheap = 0;
+	
+	hlast = (*htimeoutheap) [--cttimeoutheap];
+	
+	if (hlast == hg) /*was the last one*/
+		return;
+	
+	timeoutheapset (ix, hlast);
+	
+	if (ix > 1 && timeoutbefore (hlast, (*htimeoutheap) [ix / 2 - 1]))
+		timeoutheapsiftup (ix);
+	else
+		timeoutheapsiftdown (ix);
+	} /*timeoutheapremove*/
+
+
 boolean processsleep (hdlprocessthread hthread, unsigned long timeout) {
 	
 	/*
@@ -1037,11 +1495,16 @@ boolean processsleep (hdlprocessthread hthread, unsigned long timeout) {
 
 	6.2b7 AR: Properly handle wrapping around of tick count (happens every 16.5 days on Win32).
 	If timeout is 0xffffffff, processchecktimeouts will never wake the thread.
+	
+	threads sleeping with a timeout go into the timeout heap, so processchecktimeouts 
+	only has to look at the soonest one. timetowake may wrap past zero; the heap 
+	compares wake times by their difference. a negative timeout sleeps until woken.
 	*/
 	
 	unsigned long timetowake;
 	boolean fl;
 	unsigned long ticks = gettickcount ();
+	boolean fltimed = (long) timeout >= 0;
 	
 	if (hthread == nil) //sleep the current thread
 		hthread = hthreadglobals;
@@ -1054,16 +1517,28 @@ boolean processsleep (hdlprocessthread hthread, unsigned long timeout) {
 		return (true);
 		}
 	
-	if (((long) timeout >= 0) && (ticks + timeout > timeout)) /*positive, not wrapping around*/
-		timetowake = ticks + timeout;
+	if (fltimed) {
+		
+		timetowake = ticks + timeout; /*may wrap around*/
+		
+		if (timetowake == 0) /*zero means not sleeping*/
+			timetowake = 1;
+		}
 	else
 		timetowake = 0xffffffff;
 	
 	(**(hdlthreadglobals) hthread).timetowake = timetowake;
 	
-	(**(hdlthreadglobals) hthread).sleepticks = timeout;
+	(**(hdlthreadglobals) hthread).sleepticks = fltimed? timeout : 0xffffffff;
 
 	(**(hdlthreadglobals) hthread).timebeginsleep = ticks;
+	
+	if (fltimed && !timeoutheapinsert ((hdlthreadglobals) hthread)) {
+		
+		(**(hdlthreadglobals) hthread).timetowake = 0;
+		
+		return (false);
+		}
 
 		if (processlist != nil)
 			++(**processlist).ctsleeping;
@@ -1129,6 +1604,8 @@ boolean processwake (hdlprocessthread hthread) {
 	fl = threadwake (idthread, hthread != agentthread);
 	
 	if (fl) {
+		
+		timeoutheapremove ((hdlthreadglobals) hthread);
 
 		(**(hdlthreadglobals) hthread).timetowake = 0; //6.2b11 AR: only if successful
 		
@@ -1274,6 +1751,8 @@ void disposethreadglobals (hdlthreadglobals hglobals) {
 	else
 		listunlink ((hdllinkedlist) processthreadlist, (hdllinkedlist) hg);
 	
+	timeoutheapremove (hg);
+	
 	if (hg == hthreadglobals) {
 
 		disposehandle ((Handle) hashtablestack);
@@ -1688,6 +2167,59 @@ boolean setdefaulttimeslice (unsigned long ticks) {
 	} /*setprocesstimeslice*/
 
 
+boolean getmaxoneshotthreads (long *ctmax) {
+	
+	*ctmax = maxoneshotthreads;
+	
+	return (true);
+	} /*getmaxoneshotthreads*/
+
+
+boolean setmaxoneshotthreads (long ctmax) {
+	
+	/*
+	limit the number of one-shot threads oneshotscheduler will have running 
+	at once. when the limit is reached, further one-shots wait in the process 
+	list -- a process record and a code tree, no thread or thread globals -- 
+	until a running one finishes. zero or less removes the limit.
+	
+	thread.evaluate and thread.callScript still start their thread right away, 
+	since they return its id, but their threads count toward the limit.
+	*/
+	
+	maxoneshotthreads = max (0, ctmax);
+	
+	shellforcebackgroundtask (); /*raising the limit may let queued one-shots start*/
+	
+	return (true);
+	} /*setmaxoneshotthreads*/
+
+
+long countqueuedoneshots (void) {
+	
+	/*
+	the number of one-shot processes waiting for a thread
+	*/
+	
+	register hdlprocessrecord hp;
+	long ct = 0;
+	
+	if (processlist == nil)
+		return (0);
+	
+	for (hp = (**processlist).hfirstprocess; hp != nil; hp = (**hp).hnextprocess) {
+		
+		if (!(**hp).floneshot) /*one-shots are always at the front*/
+			break;
+		
+		if (!(**hp).flscheduled)
+			++ct;
+		}
+	
+	return (ct);
+	} /*countqueuedoneshots*/
+
+
 boolean processtimesliceelapsed (void) {
 
 	hdlthreadglobals hg = getcurrentthread ();
@@ -2726,6 +3258,9 @@ boolean addprocess (hdlprocessrecord hprocess) {
 	
 	(**hp).hprocesslist = processlist;
 	
+	if (!(**hp).floneshot)
+		(**processlist).nextagenttime = 0; /*agentscheduler must look at the new agent*/
+	
 	_leavecriticalprocesssection ();
 
 	if ((**hp).floneshot)
@@ -2788,8 +3323,13 @@ static pascal void *oneshotthreadmain (void *hprocess) {
 	copystring ((**hp).bsname, bsname);
 	#endif
 
-	if (!initprocessthread (bsname)) /*must call from every thread main, before using globals*/
+	if (!initprocessthread (bsname)) { /*must call from every thread main, before using globals*/
+		
+		if (ctoneshotthreads > 0)
+			--ctoneshotthreads;
+		
 		return (nil);
+		}
 	
 	if (!(**hp).fldisposewhenidle)
 		processtimeslice (hp);
@@ -2798,6 +3338,12 @@ static pascal void *oneshotthreadmain (void *hprocess) {
 	
 	(**hlist).ctrunning--;
 	
+	if (ctoneshotthreads > 0) {
+		
+		if (ctoneshotthreads-- == maxoneshotthreads) /*a queued one-shot can have our slot*/
+			shellforcebackgroundtask ();
+		}
+	
 	if ((**hlist).fldisposewhenidle) /*try disposing now; will check ctrunning again*/
 		disposeprocesslist (hlist);
 	
@@ -2832,6 +3378,8 @@ boolean scheduleprocess (hdlprocessrecord hprocess, hdlprocessthread *hnewthread
 			
 			(**processlist).ctrunning++;
 			
+			++ctoneshotthreads;
+			
 			return (true);
 			}
 		else {
@@ -2859,6 +3407,9 @@ static void oneshotscheduler (void) {
 	threads are not available, except under the debugger where we let it fail.
 	
 	4.1b3 dmb: set new hthread field in process record
+	
+	stop starting threads once maxoneshotthreads are running; the rest 
+	stay queued until oneshotthreadmain frees a slot. see setmaxoneshotthreads
 	*/
 	
 	register hdlprocesslist hlist = processlist;
@@ -2876,6 +3427,12 @@ static void oneshotscheduler (void) {
 		
 		hnext = (**hp).hnextprocess;
 		
+		if ((**hp).flscheduled) /*already has a thread*/
+			continue;
+		
+		if (maxoneshotthreads > 0 && ctoneshotthreads >= maxoneshotthreads && flcanusethreads)
+			break;
+		
 		scheduleprocess (hp, &hthread);
 		}
 	} /*oneshotscheduler*/
@@ -2899,12 +3456,19 @@ static void agentscheduler (void) {
 	processes in the queue to run.
 	
 	2/12/92 dmb: added flsleepinbackground logic
+	
+	the list remembers the earliest time any agent is due, so seconds in 
+	which every agent is sleeping cost a single comparison instead of a 
+	walk of the whole list. anything that can make an agent due sooner 
+	lowers or clears nextagenttime.
 	*/
 	
 	register hdlprocesslist hlist = processlist;
 	register hdlprocessrecord hp;
 	register unsigned long x;
 	register hdlprocessrecord hnext;
+	unsigned long nextagenttime = 0xFFFFFFFF;
+	boolean flvisitedall = true;
 	
 	if (hlist == nil)
 		return;
@@ -2913,6 +3477,11 @@ static void agentscheduler (void) {
 	
 	x = timenow ();
 	
+	if (x < (**hlist).nextagenttime) /*nobody's due yet*/
+		goto exit;
+	
+	(**hlist).nextagenttime = 0xFFFFFFFF; /*lowered by anyone who makes an agent due during the walk*/
+	
 	for (hp = (**hlist).hfirstprocess; hp != nil; hp = hnext) { /*find a process that's not sleeping*/
 		
 		register unsigned long sleepuntil = (**hp).sleepuntil;
@@ -2922,8 +3491,13 @@ static void agentscheduler (void) {
 		if ((**hp).floneshot) /*we don't deal with one-shots here*/
 			continue;
 		
-		if ((sleepuntil != 0) && (sleepuntil > x)) /*process is sleeping*/
-			continue;		
+		if ((sleepuntil != 0) && (sleepuntil > x)) { /*process is sleeping*/
+			
+			if (sleepuntil < nextagenttime)
+				nextagenttime = sleepuntil;
+			
+			continue;
+			}
 
 		/*
 		if ((**hp).flsleepinbackground && !shellisactive ())
@@ -2942,19 +3516,41 @@ static void agentscheduler (void) {
 			
 			if ((**hthreadglobals).flretryagent)
 				(**hthreadglobals).flretryagent = false; /*reset*/
-			else
+			else {
 				deleteprocess (hp);
+				
+				hp = nil;
+				}
 			}
 		
 		(**hlist).ctrunning--;
 		
-		if (processlist != hlist) /*massive context change occured*/
+		if (processlist != hlist) { /*massive context change occured*/
+			
+			flvisitedall = false;
+			
 			break;
+			}
 		
-		if (flprocesscodedisposed) /*may have deleted code for nextnomad; safest to exit*/
+		if (flprocesscodedisposed) { /*may have deleted code for nextnomad; safest to exit*/
+			
+			flvisitedall = false;
+			
 			break;
+			}
+		
+		if (hp != nil && (**hp).sleepuntil < nextagenttime) /*it may have slept for longer*/
+			nextagenttime = (**hp).sleepuntil;
 		} /*while*/
 	
+	if (!flvisitedall)
+		(**hlist).nextagenttime = 0;
+	
+	else if (nextagenttime < (**hlist).nextagenttime)
+		(**hlist).nextagenttime = nextagenttime;
+	
+	exit:
+	
 	if ((**hlist).fldisposewhenidle) /*try disposing now; will check ctrunning again*/
 		disposeprocesslist (hlist);
 	} /*agentscheduler*/
@@ -3114,10 +3710,6 @@ static boolean processkeyboardhook (void) {
 	} /*processkeyboardhook*/
 
 
-#ifdef MACVERSION
-	#define maxticks (0xffffffffUL)
-#endif
-
 void processchecktimeouts (void) {
 
 	/*
@@ -3132,42 +3724,40 @@ void processchecktimeouts (void) {
 	waking is found. This behavior as archaic, thinking that waking on thread 
 	at a time would be all we can really handle. But this can cause deadlock,
 	which we found with the script debugger.
+	
+	sleeping threads are kept in a heap ordered by wake time, so we only 
+	look at threads that are actually due instead of walking the whole 
+	thread list every time through the main event loop. tick wraparound 
+	needs no special handling; see processsleep.
+	
+	if a thread won't wake, it's given another try on the next tick, as 
+	it would have been when we walked the list.
 	*/
 
 	register hdlthreadglobals hg;
 	unsigned long ticks = gettickcount ();
-	static unsigned long lastprocesscheckticks = 0L;
-
-	if (ticks < lastprocesscheckticks) { /*tick count wrapped around, re-compute sleep times*/
-
-		for (hg = (**processthreadlist).hfirst; hg != nil; hg = (**hg).hnextglobals) {
-			
-			unsigned long timetowake = (**hg).timetowake;
-			unsigned long sleepticks = (**hg).sleepticks;
-			unsigned long timebeginsleep = (**hg).timebeginsleep;
-			
-			if ((timetowake > 0) && (timebeginsleep > ticks) && (sleepticks != 0xffffffffUL)) {
-
-				unsigned long deltaticks = maxticks - timebeginsleep;
-
-				(**hg).timetowake = (sleepticks > deltaticks) ? (sleepticks - deltaticks) : 1UL;
-				}
-			}
-		}
-
-	lastprocesscheckticks = ticks;
 	
-	for (hg = (**processthreadlist).hfirst; hg != nil; hg = (**hg).hnextglobals) {
+	while (cttimeoutheap > 0) {
+		
+		hg = (*htimeoutheap) [0];
 		
-		unsigned long timetowake = (**hg).timetowake;
+		if ((long) (ticks - (**hg).timetowake) <= 0) /*soonest isn't due yet*/
+			break;
 		
-		if ((timetowake > 0) && (ticks > timetowake) && ((**hg).sleepticks != 0xffffffffUL)) {
+		timeoutheapremove (hg);
 		
-			wakeprocessthread ((hdlprocessthread) hg);
+		wakeprocessthread ((hdlprocessthread) hg);
+		
+		shellforcebackgroundtask ();
+		
+		if ((**hg).timetowake != 0) { /*still asleep*/
 			
-			shellforcebackgroundtask ();
+			(**hg).timetowake = ticks + 1;
+			
+			if ((**hg).timetowake == 0)
+				(**hg).timetowake = 1;
 			
-			//break; //7.1b31
+			timeoutheapinsert (hg);
 			}
 		}
 	} /*processchecktimeouts*/
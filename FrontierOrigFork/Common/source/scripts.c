@@ -66,6 +66,7 @@
 #include "osacomponent.h"
 #endif
 #include "error.h"
+#include "md5.h"
 
 static boolean scriptdebuggereventloop (void);
 
@@ -315,6 +316,381 @@ boolean scriptbuildtree (Handle htext, long signature, hdltreenode *hcode) {
 	} /*scriptbuildtree*/
 
 
+#define codecacheid 'LCOD'
+
+#define maxcodecachelines 0x7fff /*packed trees only have 16 bits for line numbers*/
+
+
+typedef struct tycodecacheheader { /*saved on disk, ahead of the packed code tree*/
+	
+	OSType cacheid; /*codecacheid*/
+	
+	short codeversion; /*langcodeversion when the code was compiled*/
+	
+	short waste; /*room to grow*/
+	
+	long signature; /*outline signature; only typeLAND is cached*/
+	
+	long ctcodebytes; /*size of the packed tree that follows*/
+	
+	byte sourcehash [16]; /*MD5 of the source text that was compiled*/
+	} tycodecacheheader;
+
+
+static void scriptgetcodecachekey (Handle htext, long signature, tycodecacheheader *key) {
+	
+	/*
+	fill in the header that identifies compiled code for this text. 
+	everything but ctcodebytes is part of the key.
+	*/
+	
+	MD5_CTX hashcontext;
+	
+	clearbytes (key, sizeof (*key));
+	
+	(*key).cacheid = conditionallongswap (codecacheid);
+	
+	(*key).codeversion = conditionalshortswap (langcodeversion);
+	
+	(*key).signature = conditionallongswap (signature);
+	
+	lockhandle (htext);
+	
+	MD5Init (&hashcontext);
+	
+	MD5Update (&hashcontext, (unsigned char *) *htext, gethandlesize (htext));
+	
+	MD5Final ((*key).sourcehash, &hashcontext);
+	
+	unlockhandle (htext);
+	} /*scriptgetcodecachekey*/
+
+
+static boolean scriptloadcodecache (hdlexternalvariable hv, dbaddress adr, tycodecacheheader *key, hdltreenode *hcode) {
+	
+	/*
+	if the cache block at adr was compiled from the same text by this version 
+	of the compiler, unpack the code instead of compiling it again.
+	*/
+	
+	Handle hcache, hpackedcode;
+	tycodecacheheader header;
+	long ix = 0;
+	
+	if (!opverbrefcodecache (hv, adr, &hcache))
+		return (false);
+	
+	if (!loadfromhandle (hcache, &ix, sizeof (header), &header))
+		goto mismatch;
+	
+	disktomemlong (header.ctcodebytes);
+	
+	if (header.ctcodebytes != gethandlesize (hcache) - ix)
+		goto mismatch;
+	
+	header.ctcodebytes = 0;
+	
+	if (memcmp (&header, key, sizeof (header)) != 0)
+		goto mismatch;
+	
+	if (!loadhandleremains (ix, hcache, &hpackedcode))
+		goto mismatch;
+	
+	disposehandle (hcache);
+	
+	return (langunpacktree (hpackedcode, hcode)); /*consumes hpackedcode*/
+	
+	mismatch:
+	
+	disposehandle (hcache);
+	
+	return (false);
+	} /*scriptloadcodecache*/
+
+
+boolean scriptpackcodecache (Handle htext, long signature, hdltreenode hcode, Handle *hcache) {
+	
+	/*
+	called by opverbpack as a script is saved: pack hcode, compiled from 
+	htext, into a cache block to be stored alongside the script, so the next 
+	time it's needed -- typically after a restart -- it can be unpacked 
+	rather than compiled. we don't consume htext.
+	
+	packed trees only have 16 bits for line numbers, so don't cache code for 
+	scripts that don't fit.
+	*/
+	
+	tycodecacheheader header;
+	register ptrbyte p;
+	register long ct;
+	long ctlines = 0;
+	
+	*hcache = nil;
+	
+	if (signature != typeLAND)
+		return (false);
+	
+	for (p = (ptrbyte) *htext, ct = gethandlesize (htext); --ct >= 0; )
+		if (*p++ == chreturn)
+			++ctlines;
+	
+	if (ctlines >= maxcodecachelines)
+		return (false);
+	
+	scriptgetcodecachekey (htext, signature, &header);
+	
+	if (!langpacktree (hcode, hcache))
+		return (false);
+	
+	header.ctcodebytes = conditionallongswap (gethandlesize (*hcache));
+	
+	if (!insertinhandle (*hcache, 0, &header, sizeof (header))) {
+		
+		disposehandle (*hcache);
+		
+		*hcache = nil;
+		
+		return (false);
+		}
+	
+	return (true);
+	} /*scriptpackcodecache*/
+
+
+#define ctstatementcachemax 512 /*top-level statements whose code we keep around, at least*/
+
+
+typedef struct tystatementcacheitem { /*code for one top-level statement of a script*/
+	
+	tyhandlecacheitem cacheitem; /*keyed by the source text of the statement*/
+	
+	Handle hpackedcode; /*its code, with line numbers counted from the statement's start*/
+	} tystatementcacheitem, *ptrstatementcacheitem, **hdlstatementcacheitem;
+
+
+static tyhandlecache statementcache = {ctstatementcachemax};
+
+
+static boolean scriptlookupstatementcache (Handle htext, unsigned long hashval, hdltreenode *hcode) {
+	
+	/*
+	if we've compiled exactly this text before, return a fresh copy of its 
+	code, and move it to the front of the cache.
+	*/
+	
+	hdlstatementcacheitem hitem;
+	Handle hpackedcode;
+	
+	if (!handlecachelookup (&statementcache, htext, hashval, (hdlhandlecacheitem *) &hitem))
+		return (false);
+	
+	if (!copyhandle ((**hitem).hpackedcode, &hpackedcode))
+		return (false);
+	
+	return (langunpacktree (hpackedcode, hcode)); /*consumes hpackedcode*/
+	} /*scriptlookupstatementcache*/
+
+
+static void scriptaddstatementcache (Handle htext, unsigned long hashval, hdltreenode hcode) {
+	
+	/*
+	remember the code for htext, which we consume. drop the least recently used 
+	statement if the cache is full. failure isn't an error.
+	*/
+	
+	hdlstatementcacheitem hitem;
+	hdlhandlecacheitem hold;
+	Handle hpackedcode;
+	
+	if (!langpacktree (hcode, &hpackedcode)) {
+		
+		disposehandle (htext);
+		
+		return;
+		}
+	
+	if (!newclearhandle (sizeof (tystatementcacheitem), (Handle *) &hitem)) {
+		
+		disposehandle (htext);
+		
+		disposehandle (hpackedcode);
+		
+		return;
+		}
+	
+	(**hitem).cacheitem.hashval = hashval;
+	
+	(**hitem).cacheitem.hkey = htext;
+	
+	(**hitem).hpackedcode = hpackedcode;
+	
+	handlecacheinsert (&statementcache, (hdlhandlecacheitem) hitem);
+	
+	while (handlecachetrim (&statementcache, &hold)) {
+		
+		disposehandle ((**hold).hkey);
+		
+		disposehandle ((**(hdlstatementcacheitem) hold).hpackedcode);
+		
+		disposehandle ((Handle) hold);
+		}
+	} /*scriptaddstatementcache*/
+
+
+static void scriptoffsetlines (hdltreenode hcode, long ctlines) {
+	
+	/*
+	move every node in the tree down by ctlines lines
+	*/
+	
+	register hdltreenode h;
+	register short ctparams;
+	
+	for (h = hcode; h != nil; h = (**h).link) {
+		
+		(**h).lnum += ctlines;
+		
+		ctparams = (**h).ctparams;
+		
+		if (ctparams > 0)
+			scriptoffsetlines ((**h).param1, ctlines);
+		
+		if (ctparams > 1)
+			scriptoffsetlines ((**h).param2, ctlines);
+		
+		if (ctparams > 2)
+			scriptoffsetlines ((**h).param3, ctlines);
+		
+		if (ctparams > 3)
+			scriptoffsetlines ((**h).param4, ctlines);
+		}
+	} /*scriptoffsetlines*/
+
+
+static boolean scriptbuildstatements (Handle htext, Handle hbreaks, hdltreenode *hcode) {
+	
+	/*
+	compile a UserTalk script one top-level statement -- usually one summit 
+	handler -- at a time, using the statement cache so that only the 
+	statements whose text has changed since we last saw them are parsed.
+	
+	the cache grows to hold all the statements of the biggest script we've 
+	compiled. a script with more statements than the cache holds would push 
+	out its own first statements while compiling its last ones, and never 
+	get a hit when it's compiled again after an edit.
+	
+	hbreaks is the list of offsets from opgetlangtextbreaks. each statement's 
+	text runs from one break up to the semicolon before the next. its code is 
+	cached with line numbers counted from the statement's first line, and 
+	moved down to where the statement sits in the script afterwards.
+	
+	we don't consume htext. if anything goes wrong, including a syntax error, 
+	we return false without reporting anything; the caller compiles the 
+	whole text in the usual way and the error is reported against the 
+	right line.
+	*/
+	
+	long ctbreaks = gethandlesize (hbreaks) / sizeof (long);
+	long cttext = gethandlesize (htext);
+	long ixstart = 0, ixend, ix;
+	long ctlines = 0; /*returns before the current statement*/
+	long ctstatementlines;
+	long i;
+	Handle hstatement, hcopy;
+	unsigned long hashval;
+	hdltreenode htree, hstatements;
+	hdltreenode hlist = nil, hlast = nil;
+	bigstring bserror;
+	
+	*hcode = nil;
+	
+	if (ctbreaks == 0) /*just one statement; nothing to gain*/
+		return (false);
+	
+	if (statementcache.ctmax <= ctbreaks) /*room for every statement, or a big script evicts itself*/
+		statementcache.ctmax = ctbreaks + 1;
+	
+	for (i = 0; i <= ctbreaks; i++) {
+		
+		if (i < ctbreaks) {
+			
+			ixend = (*(long **) hbreaks) [i] - 1;
+			
+			if ((ixend < ixstart) || (ixend >= cttext) || ((*htext) [ixend] != ';'))
+				goto error;
+			}
+		else
+			ixend = cttext;
+		
+		ix = ixstart;
+		
+		if (!loadfromhandletohandle (htext, &ix, ixend - ixstart, false, &hstatement))
+			goto error;
+		
+		for (ctstatementlines = 0, ix = ixstart; ix < ixend; ix++)
+			if ((*htext) [ix] == chreturn)
+				++ctstatementlines;
+		
+		hashval = hashhandle (hstatement);
+		
+		if (!scriptlookupstatementcache (hstatement, hashval, &htree)) {
+			
+			if (!copyhandle (hstatement, &hcopy)) {
+				
+				disposehandle (hstatement);
+				
+				goto error;
+				}
+			
+			if (!langbuildtreetraperror (hcopy, &htree, bserror)) { /*consumes hcopy*/
+				
+				disposehandle (hstatement);
+				
+				goto error;
+				}
+			
+			if (ctstatementlines < maxcodecachelines)
+				scriptaddstatementcache (hstatement, hashval, htree); /*consumes hstatement*/
+			else
+				disposehandle (hstatement);
+			}
+		else
+			disposehandle (hstatement);
+		
+		scriptoffsetlines (htree, ctlines);
+		
+		hstatements = (**htree).param1; /*detach the statement list from its moduleop*/
+		
+		(**htree).param1 = nil;
+		
+		langdisposetree (htree);
+		
+		if (hstatements != nil) {
+			
+			if (hlist == nil)
+				hlist = hstatements;
+			else
+				(**hlast).link = hstatements;
+			
+			for (hlast = hstatements; (**hlast).link != nil; hlast = (**hlast).link)
+				;
+			}
+		
+		ctlines += ctstatementlines;
+		
+		ixstart = ixend + 1; /*skip the semicolon*/
+		}
+	
+	return (pushbinaryoperation (moduleop, hlist, nil, hcode)); /*consumes hlist*/
+	
+	error:
+	
+	langdisposetree (hlist);
+	
+	return (false);
+	} /*scriptbuildstatements*/
+
+
 static boolean scriptgetcode (hdlhashnode hnode, hdltreenode *hcode) {
 	
 	/*
@@ -322,12 +698,22 @@ static boolean scriptgetcode (hdlhashnode hnode, hdltreenode *hcode) {
 	
 	5/19/92 dmb: stashes a link to the source node in the nodeval at the top of 
 	the code tree.  see comment in opverbdisposecode.
+	
+	UserTalk scripts keep a cache of their compiled code in the database, 
+	keyed by a hash of the source text and the compiler version. if it 
+	matches we unpack the cached tree; otherwise we compile, and the new 
+	code is packed into the cache when the script is next saved; see 
+	scriptpackcodecache. the compile goes statement by statement, so after 
+	an edit only the handlers that changed are parsed again.
 	*/
 	
 	tyvaluerecord val;
 	register hdlexternalvariable hv;
 	Handle htext;
+	Handle hbreaks;
 	long signature;
+	dbaddress adrcodecache;
+	tycodecacheheader key;
 	register boolean fl;
 	
 	*hcode = nil; /*default return*/
@@ -342,14 +728,52 @@ static boolean scriptgetcode (hdlhashnode hnode, hdltreenode *hcode) {
 	if ((**hv).id != idscriptprocessor) /*not a script*/
 		return (false);
 	
-	if (!opverbgetlangtext (hv, false, &htext, &signature))
+	if (!opverbgetscripttext (hv, &htext, &hbreaks, &signature, &adrcodecache))
 		return (false);
 	
-	fl = scriptbuildtree (htext, signature, hcode);
+	if (signature == typeLAND) {
+		
+		if (adrcodecache != nildbaddress) {
+			
+			scriptgetcodecachekey (htext, signature, &key);
+			
+			if (scriptloadcodecache (hv, adrcodecache, &key, hcode)) {
+				
+				disposehandle (htext);
+				
+				disposehandle (hbreaks);
+				
+				fl = true;
+				
+				goto linkcode;
+				}
+			}
+		
+		if (scriptbuildstatements (htext, hbreaks, hcode)) {
+			
+			disposehandle (htext);
+			
+			disposehandle (hbreaks);
+			
+			opverbsetcodecachepending (hv);
+			
+			fl = true;
+			
+			goto linkcode;
+			}
+		}
+	
+	disposehandle (hbreaks);
 	
+	fl = scriptbuildtree (htext, signature, hcode);
 	
 	/*7/9/90 DW: langbuildtree disposes of htext, not a memory leak*/
 	
+	if (fl && (signature == typeLAND))
+		opverbsetcodecachepending (hv);
+	
+	linkcode:
+	
 	if (fl) {
 		
 		assert ((***hcode).nodeval.data.longvalue == 0);
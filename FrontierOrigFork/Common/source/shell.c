@@ -566,7 +566,7 @@ static boolean shellgetevent (void) {
 		}
 	else {
 		
-		if (shellisactive () || flshellimmediatebackground || processrunning ())
+		if (shellisactive () || flshellimmediatebackground || processrunning () || fwsNetEventThreadsWaiting ())
 			sleep = 1;
 		else
 			sleep = min (30, maxint (1, (long) timenextbackground - gettickcount () - 20));
@@ -30,6 +30,7 @@
 
 #ifdef MACVERSION
 #include <land.h>
+#include "FastTimes.h" /*FastMicroseconds returns a UInt64*/
 #define wsprintf sprintf
 #endif
 
@@ -158,6 +159,10 @@ typedef enum tyfrontiertoken { /*verbs that are processed by frontier*/
 
 	showapplicationfunc,
 
+	handlerstatsfunc,
+
+	benchmarkfunc,
+
 	ctfrontierverbs
 	} tyfrontiertoken;
 
@@ -214,6 +219,12 @@ typedef enum tythreadtoken {
 	*/
 	statsfunc,
 	
+	getmaxoneshotsfunc,
+	
+	setmaxoneshotsfunc,
+	
+	getqueuedepthfunc,
+	
 	ctthreadverbs
 	
 	} tythreadtoken;
@@ -680,6 +691,246 @@ extern long fullpathloopcount;
 
 extern boolean hashstatsverb (tyvaluerecord *v);
 
+
+static boolean handlerstatsverb (hdltreenode hparam1, tyvaluerecord *v) {
+	
+	/*
+	frontier.handlerStats (adrTable, flReset = false): fill the table with 
+	call count, time and allocation stats for every handler called so far 
+	that hasn't since been disposed
+	*/
+	
+	hdlhashtable htable, hstatstable;
+	bigstring bs;
+	short ctconsumed = 1;
+	short ctpositional = 1;
+	tyvaluerecord vflreset;
+	
+	if (!getvarparam (hparam1, 1, &htable, bs))
+		return (false);
+	
+	setbooleanvalue (false, &vflreset);
+	
+	flnextparamislast = true;
+	
+	if (!getoptionalparamvalue (hparam1, &ctconsumed, &ctpositional, BIGSTRING ("\x07" "flReset"), &vflreset))
+		return (false);
+	
+	if (!coercetoboolean (&vflreset))
+		return (false);
+	
+	if (!langsuretablevalue (htable, bs, &hstatstable))
+		return (false);
+	
+	if (!langgethandlerstats (hstatstable, vflreset.data.flvalue))
+		return (false);
+	
+	return (setbooleanvalue (true, v));
+	} /*handlerstatsverb*/
+
+
+static boolean benchmarkwritename (handlestream *s, Handle hname) {
+	
+	/*
+	write hname to s as a JSON string, escaping quotes, backslashes and 
+	control characters
+	*/
+	
+	static byte hex [16] = "0123456789abcdef";
+	long ct = gethandlesize (hname);
+	long ix;
+	byte ch;
+	bigstring bs;
+	
+	if (!writehandlestreamchar (s, '"'))
+		return (false);
+	
+	for (ix = 0; ix < ct; ++ix) {
+		
+		ch = (*hname) [ix];
+		
+		if (ch < ' ') {
+			
+			copystring (BIGSTRING ("\x04" "\\u00"), bs);
+			
+			pushchar (hex [ch >> 4], bs);
+			
+			pushchar (hex [ch & 0x0f], bs);
+			
+			if (!writehandlestreamstring (s, bs))
+				return (false);
+			
+			continue;
+			}
+		
+		if (ch == '"' || ch == '\\')
+			if (!writehandlestreamchar (s, '\\'))
+				return (false);
+		
+		if (!writehandlestreamchar (s, ch))
+			return (false);
+		}
+	
+	return (writehandlestreamchar (s, '"'));
+	} /*benchmarkwritename*/
+
+
+static void benchmarkpushcount (UInt64 n, bigstring bs) {
+	
+	/*
+	pushlong for a 64-bit count
+	*/
+	
+	byte digits [24];
+	short ct = 0;
+	
+	do {
+		digits [ct++] = (byte) ('0' + (n % 10));
+		
+		n /= 10;
+		} while (n > 0);
+	
+	while (--ct >= 0)
+		pushchar (digits [ct], bs);
+	} /*benchmarkpushcount*/
+
+
+static boolean benchmarkverb (hdltreenode hparam1, tyvaluerecord *v) {
+	
+	/*
+	frontier.benchmark (scriptText, ctIterations = 1000, name = ""): compile 
+	scriptText once, run it ctIterations times, and return a one-line JSON 
+	record with the time per run in nanoseconds and the bytes allocated per 
+	run, for a benchmark suite to collect and compare across builds.
+	
+	the record is built in a handle, so a name of any length comes through 
+	whole. see FrontierSDK/Benchmarks for the suite and its runner.
+	*/
+	
+	Handle htext, hname, hjson;
+	hdltreenode hcode;
+	short ctconsumed = 1;
+	short ctpositional = 1;
+	tyvaluerecord viterations, vname, val;
+	bigstring bserror, bs;
+	long ctiterations, ix;
+	unsigned long startbytes, ctbytes;
+	UInt64 startmicros, ctmicros, nsperop;
+	handlestream s;
+	boolean fl = true;
+	
+	if (!getexempttextvalue (hparam1, 1, &htext))
+		return (false);
+	
+	setlongvalue (1000, &viterations);
+	
+	if (!getoptionalparamvalue (hparam1, &ctconsumed, &ctpositional, BIGSTRING ("\x0c" "ctIterations"), &viterations))
+		goto error;
+	
+	flnextparamislast = true;
+	
+	setstringvalue (zerostring, &vname);
+	
+	if (!getoptionalparamvalue (hparam1, &ctconsumed, &ctpositional, BIGSTRING ("\x04" "name"), &vname))
+		goto error;
+	
+	if (!coercetolong (&viterations) || !coercetostring (&vname))
+		goto error;
+	
+	ctiterations = max (viterations.data.longvalue, 1);
+	
+	exemptfromtmpstack (&vname); /*the runs below may clear the tmpstack*/
+	
+	hname = vname.data.stringvalue;
+	
+	if (!langbuildtreetraperror (htext, &hcode, bserror)) { /*consumes htext*/
+		
+		disposehandle (hname);
+		
+		langerrormessage (bserror);
+		
+		return (false);
+		}
+	
+	langrenumbertree (hcode); /*once, not on every run*/
+	
+	startbytes = ctbytesallocated;
+	
+	startmicros = FastMicroseconds ();
+	
+	for (ix = 0; ix < ctiterations; ++ix) {
+		
+		fl = langrunprebuilt (hcode, &val);
+		
+		if (!fl)
+			break;
+		
+		exemptfromtmpstack (&val);
+		
+		disposevaluerecord (val, false);
+		}
+	
+	ctmicros = FastMicroseconds () - startmicros;
+	
+	ctbytes = ctbytesallocated - startbytes;
+	
+	langdisposetree (hcode);
+	
+	if (!fl) {
+		
+		disposehandle (hname);
+		
+		return (false);
+		}
+	
+	nsperop = (ctmicros / ctiterations) * 1000 + ((ctmicros % ctiterations) * 1000) / ctiterations; /*divide first, in 64 bits*/
+	
+	openhandlestream (nil, &s);
+	
+	fl = writehandlestreamstring (&s, BIGSTRING ("\x09" "{\"name\": ")) && benchmarkwritename (&s, hname);
+	
+	disposehandle (hname);
+	
+	if (!fl) {
+		
+		disposehandlestream (&s);
+		
+		return (false);
+		}
+	
+	copystring (BIGSTRING ("\x10" ", \"iterations\": "), bs);
+	
+	pushlong (ctiterations, bs);
+	
+	pushstring (BIGSTRING ("\x0d" ", \"nsPerOp\": "), bs);
+	
+	benchmarkpushcount (nsperop, bs);
+	
+	pushstring (BIGSTRING ("\x10" ", \"bytesPerOp\": "), bs);
+	
+	pushlong (ctbytes / ctiterations, bs);
+	
+	pushchar ('}', bs);
+	
+	if (!writehandlestreamstring (&s, bs)) {
+		
+		disposehandlestream (&s);
+		
+		return (false);
+		}
+	
+	hjson = closehandlestream (&s);
+	
+	return (setheapvalue (hjson, stringvaluetype, v));
+	
+	error:
+	
+	disposehandle (htext);
+	
+	return (false);
+	} /*benchmarkverb*/
+
+
 static boolean frontierfunctionvalue (short token, hdltreenode hparam1, tyvaluerecord *vreturned, bigstring bserror) {
 #pragma unused (bserror)
 
@@ -839,6 +1090,12 @@ static boolean frontierfunctionvalue (short token, hdltreenode hparam1, tyvaluer
 			return (setbooleanvalue (true, v));
 			}
 
+		case handlerstatsfunc:
+			return (handlerstatsverb (hparam1, v));
+
+		case benchmarkfunc:
+			return (benchmarkverb (hparam1, v));
+
 		default:
 			return (false);
 		}
@@ -1154,6 +1411,9 @@ static boolean threadfunctionvalue (short token, hdltreenode hparam1, tyvaluerec
 			case getdefaulttimeslicefunc:
 			case settimeslicefunc:
 			case setdefaulttimeslicefunc:
+			case getmaxoneshotsfunc:
+			case setmaxoneshotsfunc:
+			case getqueuedepthfunc:
 			default:
 				return (false);
 			}
@@ -1376,6 +1636,34 @@ static boolean threadfunctionvalue (short token, hdltreenode hparam1, tyvaluerec
 				return (false);
 			
 			return (setbooleanvalue (setdefaulttimeslice (ticks), v));
+		
+		case getmaxoneshotsfunc: {
+			long ctmax;
+			
+			if (!langcheckparamcount (hparam1, 0))
+				return (false);
+			
+			getmaxoneshotthreads (&ctmax);
+			
+			return (setlongvalue (ctmax, v));
+			}
+		
+		case setmaxoneshotsfunc: {
+			long ctmax;
+			
+			flnextparamislast = true;
+			
+			if (!getlongvalue (hparam1, 1, &ctmax))
+				return (false);
+			
+			return (setbooleanvalue (setmaxoneshotthreads (ctmax), v));
+			}
+		
+		case getqueuedepthfunc:
+			if (!langcheckparamcount (hparam1, 0))
+				return (false);
+			
+			return (setlongvalue (countqueuedoneshots (), v));
 		/*
 		case begincriticalfunc:
 			if (!langcheckparamcount (hparam1, 0))
@@ -41,6 +41,7 @@
 #include "tablestructure.h"
 #include "tableinternal.h"
 #include "tableverbs.h"
+#include "opverbs.h"
 #include "claybrowser.h"
 
 
@@ -532,6 +533,20 @@ boolean tablefindvariable (hdlexternalvariable hvariable, hdlhashtable *htable,
 	} /*tablefindvariable*/
 
 
+static boolean tablesubneedssave (hdlexternalvariable hv) {
+	
+	/*
+	a sub that isn't a table needs saving if it's dirty, or if it's a script 
+	whose newly compiled code is waiting to be cached; see opverbsavecodecache
+	*/
+	
+	if (langexternalisdirty (hv))
+		return (true);
+	
+	return (((**hv).id == idscriptprocessor) && opverbcodecachepending (hv));
+	} /*tablesubneedssave*/
+
+
 static boolean nosubsdirtyvisit (hdlhashnode hnode, ptrvoid refcon) {
 #pragma unused (refcon)
 
@@ -550,7 +565,7 @@ static boolean nosubsdirtyvisit (hdlhashnode hnode, ptrvoid refcon) {
 	hv = (hdlexternalvariable) val.data.externalvalue;
 	
 	if (!istablevariable (hv))
-		return (!langexternalisdirty (hv)); /*for e.g. a dirty outline or wpdoc*/
+		return (!tablesubneedssave (hv)); /*for e.g. a dirty outline or wpdoc*/
 	
 	if (!(**hv).flinmemory) /*can't be dirty if it isn't in memory*/
 		return (true);
@@ -593,7 +608,7 @@ static boolean updatesubsdirtyvisit (hdlhashnode hnode, ptrvoid refcon) {
 		register hdlexternalvariable hv = (hdlexternalvariable) val.data.externalvalue;
 		
 		if (!istablevariable (hv)) /*once fldirtysub is true, we only need to visit sub-tables but none of the other externals*/
-			*flsubsdirty = *flsubsdirty || langexternalisdirty (hv);
+			*flsubsdirty = *flsubsdirty || tablesubneedssave (hv);
 		else
 			*flsubsdirty = ((**hv).flinmemory
 								&& !(**hnode).fldontsave
@@ -154,6 +154,14 @@ static const Size minStackSize = 512;
 
 boolean newthread (tythreadmaincallback threadmain, tythreadmainparams threadparams, void *hglobals, hdlthread *hthread) {
 
+	/*
+	script threads must be cooperative. the interpreter's state lives in 
+	globals that the switcher callbacks above copy in and out of hglobals, 
+	and tables, the database and the handle-based heap have no locking, so 
+	only one thread may touch them at a time. the Thread Manager doesn't 
+	offer preemptive threads under Carbon in any case.
+	*/
+	
 	OSErr err;
 	ThreadID idthread;
 	//Code change by Timothy Paustian Thursday, May 11, 2000 4:49:58 PM
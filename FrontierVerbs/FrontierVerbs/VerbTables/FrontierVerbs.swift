@@ -26,6 +26,8 @@ struct FrontierVerbs: VerbTable {
 		case hideApplication = "hideapplication"
 		case isValidSerialNumber = "isvalidserialnumber"
 		case showApplication = "showapplication"
+		case handlerStats = "handlerstats"
+		case benchmark = "benchmark"
 	}
 	
 	static func evaluate(_ lowerVerbName: String, _ params: VerbParams, _ verbAppDelegate: VerbAppDelegate) throws -> Value {
@@ -65,6 +67,10 @@ struct FrontierVerbs: VerbTable {
 				return true
 			case .showApplication:
 				return try showApplication(params, verbAppDelegate)
+			case .handlerStats:
+				return try handlerStats(params, verbAppDelegate)
+			case .benchmark:
+				return try benchmark(params, verbAppDelegate)
 			}
 		}
 		catch { throw error }
@@ -117,4 +123,14 @@ private extension FrontierVerbs {
 		
 		throw LangError(.unimplementedVerb)
 	}
+	
+	static func handlerStats(_ params: VerbParams, _ verbAppDelegate: VerbAppDelegate) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
+	static func benchmark(_ params: VerbParams, _ verbAppDelegate: VerbAppDelegate) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
 }
@@ -35,6 +35,7 @@ struct HTMLVerbs: VerbTable {
 		case neuterMacros = "neutermacros"
 		case neuterTags = "neutertags"
 		case drawCalendar = "drawcalendar"
+		case getMacroCacheInfo = "getmacrocacheinfo"
 	}
 	
 	static func evaluate(_ lowerVerbName: String, _ params: VerbParams, _ verbAppDelegate: VerbAppDelegate) throws -> Value {
@@ -92,6 +93,8 @@ struct HTMLVerbs: VerbTable {
 				return try neuterTags(params)
 			case .drawCalendar:
 				return try drawCalendar(params)
+			case .getMacroCacheInfo:
+				return try getMacroCacheInfo(params)
 			}
 		}
 		catch { throw error }
@@ -215,4 +218,9 @@ private extension HTMLVerbs {
 		throw LangError(.unimplementedVerb)
 	}
 	
+	static func getMacroCacheInfo(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
 }
@@ -13,6 +13,9 @@ struct ScriptVerbs: VerbTable {
 	
 	private enum Verb: String {
 		case x = "x"
+		case startSampling = "startsampling"
+		case stopSampling = "stopsampling"
+		case getSamples = "getsamples"
 	}
 	
 	static func evaluate(_ lowerVerbName: String, _ params: VerbParams, _ verbAppDelegate: VerbAppDelegate) throws -> Value {
@@ -26,6 +29,12 @@ struct ScriptVerbs: VerbTable {
 				
 			case .x:
 				return try x(params)
+			case .startSampling:
+				return try startSampling(params)
+			case .stopSampling:
+				return try stopSampling(params)
+			case .getSamples:
+				return try getSamples(params)
 			}
 		}
 		catch { throw error }
@@ -39,4 +48,19 @@ private extension ScriptVerbs {
 		throw LangError(.unimplementedVerb)
 	}
 	
+	static func startSampling(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
+	static func stopSampling(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
+	static func getSamples(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
 }
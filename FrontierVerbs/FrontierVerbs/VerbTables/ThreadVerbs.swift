@@ -34,6 +34,9 @@ struct ThreadVerbs: VerbTable {
 		case getDefaultTimeSlice = "getdefaulttimeslice"
 		case setDefaultTimeSlice = "setdefaulttimeslice"
 		case getStats = "getstats"
+		case getMaxOneShots = "getmaxoneshots"
+		case setMaxOneShots = "setmaxoneshots"
+		case getQueueDepth = "getqueuedepth"
 	}
 	
 	static func evaluate(_ lowerVerbName: String, _ params: VerbParams, _ verbAppDelegate: VerbAppDelegate) throws -> Value {
@@ -79,6 +82,12 @@ struct ThreadVerbs: VerbTable {
 				return false
 			case .getStats:
 				return try getStats(params)
+			case .getMaxOneShots:
+				return try getMaxOneShots(params)
+			case .setMaxOneShots:
+				return try setMaxOneShots(params)
+			case .getQueueDepth:
+				return try getQueueDepth(params)
 			}
 		}
 		catch { throw error }
@@ -151,4 +160,19 @@ private extension ThreadVerbs {
 		
 		throw LangError(.unimplementedVerb)
 	}
+	
+	static func getMaxOneShots(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
+	static func setMaxOneShots(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
+	static func getQueueDepth(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
 }
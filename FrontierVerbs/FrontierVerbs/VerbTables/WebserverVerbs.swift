@@ -19,6 +19,9 @@ struct WebserverVerbs: VerbTable {
 		case buildResponse = "buildresponse"
 		case buildErrorPage = "builderrorpage"
 		case getServerString = "getserverstring"
+		case streamHeaders = "streamheaders"
+		case streamChunk = "streamchunk"
+		case streamEnd = "streamend"
 	}
 	
 	static func evaluate(_ lowerVerbName: String, _ params: VerbParams, _ verbAppDelegate: VerbAppDelegate) throws -> Value {
@@ -44,6 +47,12 @@ struct WebserverVerbs: VerbTable {
 				return try buildErrorPage(params)
 			case .getServerString:
 				return try getServerString(params)
+			case .streamHeaders:
+				return try streamHeaders(params)
+			case .streamChunk:
+				return try streamChunk(params)
+			case .streamEnd:
+				return try streamEnd(params)
 			}
 		}
 		catch { throw error }
@@ -87,5 +96,20 @@ private extension WebserverVerbs {
 		throw LangError(.unimplementedVerb)
 	}
 	
+	static func streamHeaders(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
+	static func streamChunk(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
+	static func streamEnd(_ params: VerbParams) throws -> Value {
+		
+		throw LangError(.unimplementedVerb)
+	}
+	
 	
 }